@@ -0,0 +1,40 @@
+mkdir -p tmp
+
+# Cantidad de nodos de los arboles generados.
+NODOS=${NODOS:-1000000}
+OPERACIONES=$((NODOS / 2))
+
+# Genera un alias con una cadena izquierda "1 1 + 1 + ..." y otro con una
+# cadena derecha "1 1 ... 1 + + ... +", ambos de NODOS nodos.
+generar() {
+	printf 'a = cargar 1'
+	for ((i = 0; i < OPERACIONES; i++)); do printf ' 1 +'; done
+	printf '\nb = cargar'
+	for ((i = 0; i <= OPERACIONES; i++)); do printf ' 1'; done
+	for ((i = 0; i < OPERACIONES; i++)); do printf ' +'; done
+	printf '\n'
+}
+
+# Corre el interprete sobre el archivo $2, con las opciones que sigan.
+correr() {
+	echo "=== $1 ==="
+	if [ -x /usr/bin/time ]
+	then
+		/usr/bin/time -f "%e s, %M KB" ./interprete "${@:3}" < $2 > /dev/null
+	else
+		time ./interprete "${@:3}" < $2 > /dev/null
+	fi
+	echo ""
+}
+
+generar > tmp/bench_carga
+echo "salir" >> tmp/bench_carga
+(generar; printf 'evaluar a\nevaluar b\nsalir\n') > tmp/bench_evaluacion
+
+correr "carga de $NODOS nodos" tmp/bench_carga
+correr "carga y evaluacion de $NODOS nodos" tmp/bench_evaluacion
+correr "carga de $NODOS nodos, analizada con 4 hilos" tmp/bench_carga -j 4
+
+# Llamadas por segundo a la biblioteca, sin pasar por un proceso aparte.
+echo "=== interfaz de biblioteca ==="
+make -s bench_api && ./bench_api
@@ -17,3 +17,255 @@ do
 		echo "$TEST_FILE OK"
 	fi
 done
+
+# Corremos todos los tests a la vez, en paralelo, y comparamos con la
+# concatenacion de las salidas esperadas.
+TESTS=(tests/test*)
+./interprete -j 4 ${TESTS[@]} > tmp/salida
+diff <(sed -e '$a\' tmp/salida | sed 's/^[> ]*//;/^$/d') <(cat ${TESTS[@]/\/test/\/salida}) > /dev/null
+if [ $? -ne 0 ]
+then
+	echo "resultado incorrecto al correr los tests en paralelo"
+else
+	echo "tests en paralelo OK"
+fi
+
+# Corremos los tests con carga perezosa: la salida no debe cambiar.
+for TEST_FILE in tests/test*
+do
+	./interprete --perezoso < $TEST_FILE > tmp/salida
+
+	EXPECTED_OUTPUT_FILE="${TEST_FILE/\/test/\/salida}"
+
+	diff <(sed -e '$a\' tmp/salida | sed 's/^[> ]*//;/^$/d') $EXPECTED_OUTPUT_FILE > /dev/null
+	if [ $? -ne 0 ]
+	then
+		echo "resultado incorrecto en $TEST_FILE con carga perezosa"
+	fi
+done
+echo "tests con carga perezosa terminados"
+
+# Convertimos los tests al formato binario: la salida no debe cambiar.
+for TEST_FILE in tests/test*
+do
+	./interprete --convertir tmp/binario < $TEST_FILE
+	./interprete < tmp/binario > tmp/salida
+
+	EXPECTED_OUTPUT_FILE="${TEST_FILE/\/test/\/salida}"
+
+	diff <(sed -e '$a\' tmp/salida | sed 's/^[> ]*//;/^$/d') $EXPECTED_OUTPUT_FILE > /dev/null
+	if [ $? -ne 0 ]
+	then
+		echo "resultado incorrecto en $TEST_FILE en formato binario"
+	fi
+done
+# Un varint cuyo quinto byte pasa de los 32 bits es invalido (aca, el alias de
+# 'evaluar x', que truncado seria el alias 0).
+printf 'x = cargar 5\nevaluar x\n' | ./interprete --convertir tmp/binario
+(head -c -3 tmp/binario; printf '\x06\x03\x80\x80\x80\x80\x10') |
+	./interprete | grep -q 'ERROR' ||
+	echo "resultado incorrecto con un varint de mas de 32 bits"
+# Una entrada que empieza con el primer byte de la marca, sin el resto, no es
+# texto ni formato binario: se informa el error y se termina con estado 1.
+printf '\xedEDB\nevaluar x\n' | ./interprete > /dev/null 2>&1 &&
+	echo "resultado incorrecto con una marca de formato binario incompleta"
+echo "tests en formato binario terminados"
+
+# Borrar todos los alias cargados debe devolver la memoria a la del principio.
+MEMORIA=$(printf 'evaluar todos\nmemoria\n%s\n%s\nmemoria\n' \
+	"$(for i in $(seq 1000); do echo "a$i = cargar a$((i - 1)) $i + 2 *"; done)" \
+	"$(for i in $(seq 1000); do echo "borrar a$i"; done)" |
+	./interprete | grep -o '[0-9]* bytes' | uniq | wc -l)
+if [ "$MEMORIA" -ne 1 ]
+then
+	echo "la memoria no se recupero al borrar los alias"
+else
+	echo "test de memoria OK"
+fi
+
+# Una evaluacion exponencial debe cortarse al agotar el presupuesto, y la
+# sesion debe seguir. Usamos '-', que no es asociativo: una cadena de '+' que
+# repite un alias se simplificaria a un producto.
+PRESUPUESTO=$( (echo "e0 = cargar 1 1 +"
+	for i in $(seq 60); do echo "e$i = cargar e$((i - 1)) 0 e$((i - 1)) - -"; done
+	printf 'evaluar e60\nevaluar e10\n') |
+	timeout 10 ./interprete --limite-nodos 100000 | sed 's/^[> ]*//;/^$/d')
+if [ "$PRESUPUESTO" != "$(printf "ERROR: La evaluacion de 'e60' excedio el presupuesto.\n2048")" ]
+then
+	echo "el presupuesto de evaluacion no corto la evaluacion"
+else
+	echo "test de presupuesto OK"
+fi
+
+# Una linea de mas de un MiB se analiza de a tramos en paralelo: la expresion
+# debe ser la misma que al analizarla de corrido.
+(printf 'b = cargar 7\na = cargar'
+	for ((i = 0; i < 100000; i++)); do printf ' %d b + 3 * --' $i; done
+	for ((i = 1; i < 100000; i++)); do printf ' -'; done
+	printf '\nimprimir a\nevaluar a\n') > tmp/linea_larga
+./interprete < tmp/linea_larga > tmp/salida
+./interprete -j 4 < tmp/linea_larga | cmp -s - tmp/salida
+if [ $? -ne 0 ]
+then
+	echo "resultado incorrecto al analizar una linea larga en paralelo"
+else
+	echo "test de linea larga OK"
+fi
+
+# El tokenizador vectorizado debe reconocer los mismos tokens que el escalar.
+# Generamos lineas al azar con nombres, numeros, espacios y operadores de
+# largos variados, para que los tokens crucen los limites de los bloques de 16
+# bytes en distintas posiciones.
+make -s interprete_escalar
+awk 'function espacio(   texto, largo, j) {
+	largo = 1 + int(rand() * (rand() < 0.2 ? 40 : 3))
+	for (j = 0; j < largo; ++j)
+		texto = texto (rand() < 0.8 ? " " : "\t")
+	return texto
+}
+function pieza(tipo,   texto, largo, j) {
+	largo = 1 + int(rand() * (rand() < 0.3 ? 40 : 4))
+	if (tipo < 0.5) {
+		texto = substr("abcXYZ_", 1 + int(rand() * 7), 1)
+		for (j = 1; j < largo; ++j)
+			texto = texto substr("abcdeXYZ_0123456789", 1 + int(rand() * 19), 1)
+	}
+	else
+		for (j = 0; j < largo; ++j)
+			texto = texto int(rand() * 10)
+	return texto
+}
+BEGIN {
+	srand(7)
+	split("+ - -- * % / ^ = , # _ ; cargar evaluar todos", simbolos, " ")
+	for (linea = 0; linea < 2000; ++linea) {
+		texto = "a" int(rand() * 50) " = cargar"
+		if (rand() < 0.5) {
+			# Una expresion valida: operandos, y operadores que los combinan.
+			apilados = 0
+			piezas = 1 + int(rand() * 12)
+			for (k = 0; k < piezas || apilados > 1; ++k) {
+				if (apilados > 1 && (k >= piezas || rand() < 0.4)) {
+					texto = texto espacio() simbolos[1 + int(rand() * 4)]
+					apilados -= 1
+				}
+				else {
+					operando = rand() < 0.2 ? "a" int(rand() * 50) : pieza(rand())
+					texto = texto espacio() operando
+					apilados += 1
+				}
+			}
+		}
+		else {
+			# Una linea cualquiera, probablemente invalida.
+			if (rand() < 0.2)
+				texto = ""
+			piezas = int(rand() * 12)
+			for (k = 0; k < piezas; ++k)
+			{
+				simbolo = simbolos[1 + int(rand() * 15)]
+				texto = texto espacio() (rand() < 0.7 ? pieza(rand()) : simbolo)
+			}
+		}
+		print texto espacio()
+		if (rand() < 0.5)
+			print "imprimir a" int(rand() * 50)
+	}
+	print "evaluar todos"
+}' > tmp/tokens
+./interprete < tmp/tokens > tmp/salida
+./interprete_escalar < tmp/tokens | cmp -s - tmp/salida
+if [ $? -ne 0 ]
+then
+	echo "resultado incorrecto del tokenizador vectorizado"
+else
+	echo "test de tokenizador OK"
+fi
+
+# Las sentencias que no modifican el entorno (evaluar, imprimir, salir y los
+# errores) no deben reservar memoria: 'interprete_reservas' las cuenta, y aborta
+# si alguna reserva.
+make -s interprete_reservas
+RESERVAS=0
+for TEST_FILE in tests/test*
+do
+	./interprete --convertir tmp/binario < $TEST_FILE
+	if ! ./interprete_reservas < $TEST_FILE > /dev/null ||
+		! ./interprete_reservas < tmp/binario > /dev/null
+	then
+		echo "$TEST_FILE reservo memoria en una sentencia de solo lectura"
+		RESERVAS=1
+	fi
+done
+(echo "x = cargar 1 2 +"
+	echo "y = cargar x x * z +"
+	for i in $(seq 1000)
+	do
+		printf 'evaluar x\nimprimir y\nevaluar y\nevaluar w\nimprimir w\n'
+		printf 'a = cargar 1 +\nb = cargar\nmostrar\n+ 1\n'
+	done
+	# Un alias profundo (o que usa uno definido despues) necesita mas pila que
+	# la reservada al principio: se reserva al cargarlo, no al evaluarlo.
+	echo "p = cargar q 1 +"
+	echo "q = cargar $(yes 1 | head -n 3000) $(yes - | head -n 2999)" | tr '\n' ' '
+	printf '\nevaluar q\nevaluar p\n') > tmp/solo_lectura
+./interprete_reservas < tmp/solo_lectura > /dev/null || RESERVAS=1
+if [ $RESERVAS -ne 0 ]
+then
+	echo "resultado incorrecto al contar las reservas"
+else
+	echo "test de reservas OK"
+fi
+
+# Con --diario, una sesion nueva debe recuperar los alias de la anterior (aun
+# si la anterior se corto a mitad de un registro), y el diario debe compactarse
+# cuando se redefinen muchas veces los mismos alias.
+DIARIO=0
+rm -f tmp/diario tmp/diario.tmp
+printf 'a = cargar 1 2 +\nb = cargar a a *\nc = cargar 5\nborrar c\n' > tmp/diario_1
+printf 'instantanea\na = cargar 3\nd = cargar b 1 -\nrestaurar 0\ne = cargar 2 d +\n' >> tmp/diario_1
+printf 'imprimir b\nevaluar todos\n' > tmp/diario_2
+./interprete --diario tmp/diario < tmp/diario_1 > /dev/null
+./interprete --perezoso --diario tmp/diario < tmp/diario_2 |
+	sed 's/^[> ]*//;/^$/d' > tmp/salida
+cat tmp/diario_1 tmp/diario_2 | ./interprete | sed 's/^[> ]*//;/^$/d' |
+	tail -n 4 | cmp -s - tmp/salida || DIARIO=1
+head -c -2 tmp/diario > tmp/diario_cortado && mv tmp/diario_cortado tmp/diario
+RECUPERADO=$(printf 'f = cargar 8\nevaluar todos\n' |
+	./interprete --diario tmp/diario | sed 's/^[> ]*//;/^$/d')
+[ "$RECUPERADO" == "$(printf 'a = 3\nb = 9\nf = 8')" ] || DIARIO=1
+[ "$(echo 'evaluar f' | ./interprete --diario tmp/diario | sed 's/^[> ]*//')" == "8" ] ||
+	DIARIO=1
+rm -f tmp/diario
+(for i in $(seq 20000); do echo "a$((i % 10)) = cargar $i b +"; done
+	echo "b = cargar 1"; echo "borrar a3"; echo "evaluar todos") > tmp/diario_1
+./interprete --diario tmp/diario < tmp/diario_1 | sed 's/^[> ]*//;/^$/d' |
+	tail -n 10 > tmp/salida
+echo "evaluar todos" | ./interprete --diario tmp/diario |
+	sed 's/^[> ]*//;/^$/d' | cmp -s - tmp/salida || DIARIO=1
+./interprete --convertir tmp/binario < tmp/diario_1
+[ $(stat -c %s tmp/diario) -lt $(($(stat -c %s tmp/binario) / 2)) ] || DIARIO=1
+# Una sesion perezosa guarda el texto de sus cargas, que se arma al
+# reproducirlas (o al usarse, si la sesion que reproduce tambien es perezosa).
+rm -f tmp/diario
+./interprete --perezoso --diario tmp/diario < tmp/diario_1 > /dev/null
+for MODO in "" --perezoso; do
+	echo "evaluar todos" | ./interprete $MODO --diario tmp/diario |
+		sed 's/^[> ]*//;/^$/d' | cmp -s - tmp/salida || DIARIO=1
+done
+# Si no se puede escribir el diario (aca, por el limite de tamano de archivo),
+# se informa una vez, el diario queda en el ultimo lote completo, y la sesion
+# termina con error. Lo mismo si no se puede abrir.
+rm -f tmp/diario
+(echo "a0 = cargar 1"; sleep 0.3; for i in $(seq 400); do echo "a$i = cargar $i"; done) |
+	(trap '' XFSZ; ulimit -f 1; ./interprete --diario tmp/diario > /dev/null 2> tmp/error)
+[ $? -eq 1 ] && [ $(wc -l < tmp/error) -eq 1 ] || DIARIO=1
+echo "evaluar todos" | ./interprete --diario tmp/diario | sed 's/^[> ]*//;/^$/d' |
+	awk -F' = ' '$1 != "a" NR - 1 || ($2 != NR - 1 && NR > 1) { exit 1 }' || DIARIO=1
+echo "evaluar a0" | ./interprete --diario tmp/no/existe > /dev/null 2>&1 && DIARIO=1
+if [ $DIARIO -ne 0 ]
+then
+	echo "resultado incorrecto al recuperar los alias del diario"
+else
+	echo "test de diario OK"
+fi
@@ -0,0 +1,94 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Microbenchmark de la interfaz de biblioteca: mide cuantas llamadas por
+// segundo se pueden hacer sin pasar por un proceso aparte.
+
+#include "tabla_ops.h"
+#include "operadores.h"
+#include "interprete/interpretar.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Devuelve el tiempo actual en segundos.
+static double reloj(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Imprime la cantidad de llamadas por segundo de una medicion.
+static void informar(char const* nombre, int llamadas, double inicio) {
+	double segundos = reloj() - inicio;
+	printf("%-28s %10.0f llamadas/s\n", nombre, llamadas / segundos);
+}
+
+int main(int argc, char** argv) {
+	int llamadas = argc > 1 ? atoi(argv[1]) : 1000000;
+
+	TablaOps tabla = tabla_ops_crear();
+	cargar_operador(&tabla, "+", 2, suma, 0);
+	cargar_operador(&tabla, "-", 2, resta, 1);
+	cargar_operador(&tabla, "*", 2, producto, 3);
+	cargar_propiedades(&tabla, "+", OP_ASOCIATIVA | OP_CONMUTATIVA | OP_NEUTRO, 0);
+	cargar_propiedades(&tabla, "*", OP_ASOCIATIVA | OP_CONMUTATIVA | OP_NEUTRO, 1);
+	cargar_reduccion(&tabla, "+", suma_arreglo);
+	cargar_reduccion(&tabla, "*", producto_arreglo);
+	cargar_repeticion(&tabla, "+", "*");
+
+	Entorno* entorno = entorno_nuevo(&tabla);
+	int ok = entorno_definir(entorno, "x", "1 2 +", NULL) &&
+		entorno_definir(entorno, "y", "x x * 3 -", NULL);
+	assert(ok);
+	(void)ok;
+
+	// Evaluacion de un alias ya definido.
+	double inicio = reloj();
+	long long total = 0;
+	for (int i = 0; i < llamadas; ++i) {
+		int valor;
+		entorno_evaluar(entorno, "y", &valor, NULL);
+		total += valor;
+	}
+	informar("entorno_evaluar", llamadas, inicio);
+	assert(total == 6LL * llamadas);
+
+	// Redefinicion desde texto, y evaluacion.
+	inicio = reloj();
+	for (int i = 0; i < llamadas; ++i) {
+		int valor;
+		entorno_definir(entorno, "x", "2 2 +", NULL);
+		entorno_evaluar(entorno, "y", &valor, NULL);
+		assert(valor == 13);
+	}
+	informar("entorno_definir + evaluar", llamadas, inicio);
+
+	// Redefinicion con un arbol armado, y evaluacion.
+	EntradaTablaOps* mas = tabla_ops_buscar(&tabla, "+");
+	inicio = reloj();
+	for (int i = 0; i < llamadas; ++i) {
+		Expresion* expresion = expresion_crear(3);
+		expresion_numero(&expresion, i);
+		expresion_numero(&expresion, 1);
+		expresion_operacion(&expresion, mas);
+		int valor;
+		entorno_definir_expresion(entorno, "x", expresion, NULL);
+		entorno_evaluar(entorno, "x", &valor, NULL);
+		assert(valor == i + 1);
+	}
+	informar("entorno_definir_expresion", llamadas, inicio);
+
+	// Impresion en un buffer.
+	char buffer[64];
+	entorno_definir(entorno, "x", "1 2 +", NULL);
+	inicio = reloj();
+	for (int i = 0; i < llamadas; ++i)
+		entorno_imprimir(entorno, "y", buffer, sizeof(buffer), NULL);
+	informar("entorno_imprimir", llamadas, inicio);
+	printf("y = %s\n", buffer);
+
+	entorno_destruir(entorno);
+	tabla_ops_limpiar(&tabla);
+}
@@ -3,4 +3,8 @@
 
 typedef int (*FuncionEvaluacion)(int*);
 
+// Aplica una operacion asociativa a los 'n' valores del arreglo (n >= 1), de
+// izquierda a derecha.
+typedef int (*FuncionReduccion)(int const* valores, int n);
+
 #endif // FUNCION_EVALUACION_H
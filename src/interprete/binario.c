@@ -0,0 +1,678 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "binario.h"
+
+#include "expresion.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Largo maximo de un registro. Acota la memoria que reserva el lector ante un
+// archivo corrupto.
+#define MAX_REGISTRO ((uint32_t)1 << 30)
+
+
+// Lectura.
+
+// Lee un varint de 'p' sin pasar de 'fin', y avanza 'p'.
+// Devuelve 0 si el varint esta cortado o no entra en 32 bits.
+static int leer_varint(unsigned char const** p, unsigned char const* fin,
+	uint32_t* valor) {
+	uint32_t resultado = 0;
+	for (int corrimiento = 0; corrimiento < 35; corrimiento += 7) {
+		if (*p == fin)
+			return 0;
+		unsigned char byte = *(*p)++;
+		// El quinto byte solo aporta los 4 bits mas altos.
+		if (corrimiento == 28 && (byte & 0x70))
+			return 0;
+		resultado |= (uint32_t)(byte & 0x7f) << corrimiento;
+		if (!(byte & 0x80)) {
+			*valor = resultado;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Lee el largo de un registro de la entrada. Devuelve 0 si la entrada termino
+// o si el largo no entra en 32 bits.
+static int leer_largo(FILE* entrada, uint32_t* largo) {
+	uint32_t resultado = 0;
+	for (int corrimiento = 0; corrimiento < 35; corrimiento += 7) {
+		int byte = getc(entrada);
+		if (byte == EOF || (corrimiento == 28 && (byte & 0x70)))
+			return 0;
+		resultado |= (uint32_t)(byte & 0x7f) << corrimiento;
+		if (!(byte & 0x80)) {
+			*largo = resultado;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Lee el proximo registro en el buffer del lector, seguido de un '\0' (para
+// poder devolver el resto de una sentencia invalida como string).
+// Devuelve 0 si la entrada termino. Un registro cortado se trata como el fin
+// de la entrada.
+static int leer_registro(LectorBinario* lector, FILE* entrada,
+	uint32_t* largo) {
+	if (!leer_largo(entrada, largo) || *largo > MAX_REGISTRO)
+		return 0;
+	if (*largo + 1 > lector->capacidadBuffer) {
+		lector->capacidadBuffer = *largo + 1 > 2 * lector->capacidadBuffer ?
+			*largo + 1 : 2 * lector->capacidadBuffer;
+		lector->buffer = realloc(lector->buffer, lector->capacidadBuffer);
+		assert(lector->buffer);
+	}
+	if (fread(lector->buffer, 1, *largo, entrada) != *largo)
+		return 0;
+	lector->buffer[*largo] = '\0';
+	return 1;
+}
+
+// Agrega un alias a las declaraciones del lector.
+static void declarar_alias(LectorBinario* lector, unsigned char const* texto,
+	int largo) {
+	if (lector->cantidadAlias == lector->capacidadAlias) {
+		lector->capacidadAlias = lector->capacidadAlias ?
+			2 * lector->capacidadAlias : 16;
+		lector->alias = realloc(lector->alias,
+			lector->capacidadAlias * sizeof(*lector->alias));
+		lector->largos = realloc(lector->largos,
+			lector->capacidadAlias * sizeof(*lector->largos));
+		assert(lector->alias && lector->largos);
+	}
+	char* copia = malloc(largo + 1);
+	assert(copia);
+	memcpy(copia, texto, largo);
+	copia[largo] = '\0';
+	lector->alias[lector->cantidadAlias] = copia;
+	lector->largos[lector->cantidadAlias] = largo;
+	lector->cantidadAlias += 1;
+}
+
+// Agrega un operador a las declaraciones del lector, buscandolo por simbolo en
+// la tabla. Si no esta, se declara igual, pero las cargas que lo usen seran
+// invalidas.
+static void declarar_operador(LectorBinario* lector, TablaOps* tablaOps,
+	unsigned char const* simbolo, size_t largo) {
+	if (lector->cantidadOps == lector->capacidadOps) {
+		lector->capacidadOps = lector->capacidadOps ?
+			2 * lector->capacidadOps : 16;
+		lector->ops = realloc(lector->ops,
+			lector->capacidadOps * sizeof(*lector->ops));
+		assert(lector->ops);
+	}
+	EntradaTablaOps* encontrado = NULL;
+	for (int i = 0; i < tablaOps->cantidad; ++i) {
+		char const* candidato = tablaOps->entradas[i].simbolo;
+		if (strlen(candidato) == largo && memcmp(candidato, simbolo, largo) == 0)
+			encontrado = &tablaOps->entradas[i];
+	}
+	lector->ops[lector->cantidadOps++] = encontrado;
+}
+
+// Funciones auxiliares para construir una estructura 'Parseado'.
+static Parseado leido_invalido(ErrorTag error) {
+	return (Parseado){"", (Sentencia){.tag = S_INVALIDO}, error};
+}
+static Parseado leido_sentencia(SentenciaTag tag, LectorBinario* lector,
+	uint32_t alias, Expresion* expresion) {
+	return (Parseado){"", (Sentencia){
+		.tag = tag,
+		.alias = lector->alias[alias],
+		.alias_n = lector->largos[alias],
+		.expresion = expresion,
+	}, 0};
+}
+
+// Decodifica una carga: el alias, la cantidad de nodos, y los nodos.
+// Valida la expresion igual que 'parsear': cada operador debe tener sus
+// operandos, y al final debe quedar un unico subarbol.
+static Parseado leer_carga(LectorBinario* lector, unsigned char const* p,
+	unsigned char const* fin) {
+	uint32_t alias, n;
+	if (!leer_varint(&p, fin, &alias) || alias >= (uint32_t)lector->cantidadAlias)
+		return leido_invalido(E_PARSER_ALIAS);
+	if (!leer_varint(&p, fin, &n))
+		return leido_invalido(E_PARSER_EXPRESION);
+	if (n == 0)
+		return leido_invalido(E_PARSER_VACIA);
+	// Cada nodo ocupa al menos un byte: acotamos 'n' antes de reservar memoria.
+	if (n > (uint32_t)(fin - p))
+		return leido_invalido(E_PARSER_EXPRESION);
+
+	Expresion* expresion = expresion_crear(n);
+	uint32_t subarboles = 0;
+	for (uint32_t i = 0; i < n; ++i) {
+		uint32_t codigo, valor;
+		if (!leer_varint(&p, fin, &codigo))
+			goto fallo;
+		if (codigo == BINARIO_NUMERO) {
+			if (!leer_varint(&p, fin, &valor))
+				goto fallo;
+			// deshacemos el zigzag.
+			expresion_numero(&expresion, (int32_t)((valor >> 1) ^ -(valor & 1)));
+			subarboles += 1;
+		}
+		else if (codigo == BINARIO_ALIAS) {
+			if (!leer_varint(&p, fin, &valor) ||
+				valor >= (uint32_t)lector->cantidadAlias)
+				goto fallo;
+			expresion_alias(&expresion, lector->alias[valor], lector->largos[valor]);
+			subarboles += 1;
+		}
+		else {
+			codigo -= BINARIO_OPERADOR;
+			if (codigo >= (uint32_t)lector->cantidadOps)
+				goto fallo;
+			EntradaTablaOps* op = lector->ops[codigo];
+			// Si el operador no existe o faltan operandos, es invalida.
+			if (op == NULL || subarboles < (uint32_t)op->aridad)
+				goto fallo;
+			expresion_operacion(&expresion, op);
+			subarboles -= op->aridad - 1;
+		}
+	}
+	// Si sobran bytes o subarboles, la expresion es invalida.
+	if (p != fin || subarboles != 1)
+		goto fallo;
+	return leido_sentencia(S_CARGA, lector, alias, expresion);
+
+	fallo:
+	expresion_limpiar(expresion);
+	return leido_invalido(E_PARSER_EXPRESION);
+}
+
+// Decodifica una carga con el texto de su expresion: el alias, y el texto hasta
+// el final del registro (que termina en el '\0' que agrega 'leer_registro').
+// La expresion se valida igual que 'parsear', pero no se arma.
+static Parseado leer_carga_fuente(LectorBinario* lector, TablaOps* tablaOps,
+	unsigned char const* p, unsigned char const* fin) {
+	uint32_t alias;
+	if (!leer_varint(&p, fin, &alias) || alias >= (uint32_t)lector->cantidadAlias)
+		return leido_invalido(E_PARSER_ALIAS);
+	char const* fuente = (char const*)p;
+	// Un '\0' en el medio cortaria el texto.
+	if (strlen(fuente) != (size_t)(fin - p))
+		return leido_invalido(E_PARSER_EXPRESION);
+	ErrorTag error;
+	if (!validar_expresion(fuente, tablaOps, &error))
+		return leido_invalido(error);
+	Parseado parseado = leido_sentencia(S_CARGA, lector, alias, NULL);
+	parseado.sentencia.fuente = fuente;
+	return parseado;
+}
+
+// Decodifica una sentencia cuyo unico argumento es un alias.
+static Parseado leer_sentencia_alias(LectorBinario* lector, SentenciaTag tag,
+	unsigned char const* p, unsigned char const* fin) {
+	uint32_t alias;
+	if (!leer_varint(&p, fin, &alias) || p != fin ||
+		alias >= (uint32_t)lector->cantidadAlias)
+		return leido_invalido(E_PARSER_ALIAS);
+	return leido_sentencia(tag, lector, alias, NULL);
+}
+
+// Decodifica una especializacion: el alias y los alias variables.
+static Parseado leer_especializar(LectorBinario* lector,
+	unsigned char const* p, unsigned char const* fin) {
+	uint32_t alias;
+	if (!leer_varint(&p, fin, &alias) || alias >= (uint32_t)lector->cantidadAlias)
+		return leido_invalido(E_PARSER_ALIAS);
+	Expresion* variables = expresion_crear(4);
+	do {
+		uint32_t variable;
+		if (!leer_varint(&p, fin, &variable) ||
+			variable >= (uint32_t)lector->cantidadAlias) {
+			expresion_limpiar(variables);
+			return leido_invalido(E_PARSER_ALIAS);
+		}
+		expresion_alias(&variables, lector->alias[variable],
+			lector->largos[variable]);
+	} while (p != fin);
+	return leido_sentencia(S_ESPECIALIZAR, lector, alias, variables);
+}
+
+int binario_detectar(FILE* entrada) {
+	int c = getc(entrada);
+	if (c != (unsigned char)BINARIO_MARCA[0]) {
+		if (c != EOF)
+			ungetc(c, entrada);
+		return 0;
+	}
+	char marca[BINARIO_MARCA_N - 1];
+	return fread(marca, 1, sizeof(marca), entrada) == sizeof(marca) &&
+		memcmp(marca, BINARIO_MARCA + 1, sizeof(marca)) == 0 ? 1 : -1;
+}
+
+LectorBinario lector_binario_crear(void) {
+	return (LectorBinario){0};
+}
+
+int binario_leer(LectorBinario* lector, FILE* entrada, TablaOps* tablaOps,
+	Parseado* parseado) {
+	// Procesamos las declaraciones hasta encontrar una sentencia.
+	while (1) {
+		uint32_t largo;
+		if (!leer_registro(lector, entrada, &largo))
+			return 0;
+		unsigned char const* p = lector->buffer;
+		unsigned char const* fin = p + largo;
+		if (p == fin) {
+			*parseado = leido_invalido(E_PARSER_OPERACION);
+			return 1;
+		}
+
+		switch (*p++) {
+		case B_ALIAS:
+			declarar_alias(lector, p, fin - p);
+			break;
+		case B_OPERADOR:
+			declarar_operador(lector, tablaOps, p, fin - p);
+			break;
+		case B_CARGA:
+			*parseado = leer_carga(lector, p, fin);
+			return 1;
+		case B_EVALUAR:
+			*parseado = leer_sentencia_alias(lector, S_EVALUAR, p, fin);
+			return 1;
+		case B_IMPRIMIR:
+			*parseado = leer_sentencia_alias(lector, S_IMPRIMIR, p, fin);
+			return 1;
+		case B_OBSERVAR:
+			*parseado = leer_sentencia_alias(lector, S_OBSERVAR, p, fin);
+			return 1;
+		case B_MOSTRAR:
+			*parseado = leer_sentencia_alias(lector, S_MOSTRAR, p, fin);
+			return 1;
+		case B_SALIR:
+			*parseado = (Parseado){"", (Sentencia){.tag = S_SALIR}, 0};
+			return 1;
+		case B_EVALUAR_TODOS:
+			*parseado = (Parseado){"", (Sentencia){.tag = S_EVALUAR_TODOS}, 0};
+			return 1;
+		case B_INSTANTANEA:
+			*parseado = (Parseado){"", (Sentencia){.tag = S_INSTANTANEA}, 0};
+			return 1;
+		case B_RESTAURAR: {
+			uint32_t numero;
+			if (!leer_varint(&p, fin, &numero) || p != fin)
+				*parseado = leido_invalido(E_PARSER_NUMERO);
+			else
+				*parseado = (Parseado){"", 
+					(Sentencia){.tag = S_RESTAURAR, .numero = (int32_t)numero}, 0};
+			return 1;
+		}
+		case B_BORRAR:
+			*parseado = leer_sentencia_alias(lector, S_BORRAR, p, fin);
+			return 1;
+		case B_MEMORIA:
+			*parseado = (Parseado){"", (Sentencia){.tag = S_MEMORIA}, 0};
+			return 1;
+		case B_ESPECIALIZAR:
+			*parseado = leer_especializar(lector, p, fin);
+			return 1;
+		case B_CARGA_FUENTE:
+			*parseado = leer_carga_fuente(lector, tablaOps, p, fin);
+			return 1;
+		case B_INVALIDO:
+			// Solo se guardan errores del parser.
+			if (p == fin || *p >= E_INTERPRETE_ALIAS) {
+				*parseado = leido_invalido(E_PARSER_OPERACION);
+				return 1;
+			}
+			*parseado = leido_invalido(*p);
+			parseado->resto = (char const*)p + 1;
+			return 1;
+		default:
+			*parseado = leido_invalido(E_PARSER_OPERACION);
+			return 1;
+		}
+	}
+}
+
+void lector_binario_limpiar(LectorBinario* lector) {
+	for (int i = 0; i < lector->cantidadAlias; ++i)
+		free(lector->alias[i]);
+	free(lector->alias);
+	free(lector->largos);
+	free(lector->ops);
+	free(lector->buffer);
+	*lector = lector_binario_crear();
+}
+
+
+// Escritura.
+
+// Alias declarado por el escritor, en una tabla hash de direccionamiento
+// abierto. Las posiciones libres tienen texto NULL.
+struct AliasDeclarado {
+	char* texto;
+	int largo;
+	uint32_t numero;
+};
+
+// Agrega 'n' bytes al final de un buffer que duplica su capacidad al llenarse.
+static void agregar_bytes(unsigned char** buffer, size_t* largo,
+	size_t* capacidad, void const* bytes, size_t n) {
+	if (*largo + n > *capacidad) {
+		while (*largo + n > *capacidad)
+			*capacidad = *capacidad ? 2 * *capacidad : 64;
+		*buffer = realloc(*buffer, *capacidad);
+		assert(*buffer);
+	}
+	memcpy(*buffer + *largo, bytes, n);
+	*largo += n;
+}
+
+// Agrega bytes al registro en armado.
+static void poner_bytes(EscritorBinario* escritor, void const* bytes,
+	size_t n) {
+	agregar_bytes(&escritor->registro, &escritor->largo, &escritor->capacidad,
+		bytes, n);
+}
+
+// Codifica un varint en 'bytes'. Devuelve la cantidad de bytes usados.
+static int codificar_varint(unsigned char* bytes, uint32_t valor) {
+	int n = 0;
+	while (valor >= 0x80) {
+		bytes[n++] = (valor & 0x7f) | 0x80;
+		valor >>= 7;
+	}
+	bytes[n++] = valor;
+	return n;
+}
+
+static void poner_varint(EscritorBinario* escritor, uint32_t valor) {
+	unsigned char bytes[5];
+	poner_bytes(escritor, bytes, codificar_varint(bytes, valor));
+}
+
+// Empieza un registro del tipo dado.
+static void comenzar_registro(EscritorBinario* escritor, RegistroBinario tipo) {
+	unsigned char byte = tipo;
+	escritor->largo = 0;
+	poner_bytes(escritor, &byte, 1);
+}
+
+// Escribe el registro en armado, precedido por su largo (en la salida, o en
+// los bytes del escritor si no tiene).
+static int terminar_registro(EscritorBinario* escritor) {
+	unsigned char bytes[5];
+	int n = codificar_varint(bytes, escritor->largo);
+	if (escritor->salida == NULL) {
+		agregar_bytes(&escritor->bytes, &escritor->cantidadBytes,
+			&escritor->capacidadBytes, bytes, n);
+		agregar_bytes(&escritor->bytes, &escritor->cantidadBytes,
+			&escritor->capacidadBytes, escritor->registro, escritor->largo);
+		return 1;
+	}
+	return fwrite(bytes, 1, n, escritor->salida) == (size_t)n &&
+		fwrite(escritor->registro, 1, escritor->largo, escritor->salida) ==
+			escritor->largo;
+}
+
+// Funcion de hash FNV-1a.
+static uint32_t hash(char const* texto, int largo) {
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < largo; ++i)
+		h = (h ^ (unsigned char)texto[i]) * 16777619u;
+	return h;
+}
+
+// Busca la posicion del alias en la tabla hash: la que lo contiene, o la
+// posicion libre donde deberia insertarse.
+static AliasDeclarado* buscar_alias(EscritorBinario* escritor,
+	char const* texto, int largo) {
+	uint32_t mascara = escritor->capacidadAlias - 1;
+	for (uint32_t i = hash(texto, largo) & mascara; ; i = (i + 1) & mascara) {
+		AliasDeclarado* it = &escritor->alias[i];
+		if (it->texto == NULL ||
+			(it->largo == largo && memcmp(it->texto, texto, largo) == 0))
+			return it;
+	}
+}
+
+// Duplica la capacidad de la tabla hash de alias.
+static void agrandar_alias(EscritorBinario* escritor) {
+	AliasDeclarado* viejos = escritor->alias;
+	uint32_t capacidadVieja = escritor->capacidadAlias;
+	escritor->capacidadAlias = capacidadVieja ? 2 * capacidadVieja : 64;
+	escritor->alias = calloc(escritor->capacidadAlias, sizeof(AliasDeclarado));
+	assert(escritor->alias);
+	for (uint32_t i = 0; i < capacidadVieja; ++i)
+		if (viejos[i].texto)
+			*buscar_alias(escritor, viejos[i].texto, viejos[i].largo) = viejos[i];
+	free(viejos);
+}
+
+// Busca el alias entre los declarados y, si no esta, lo agrega (sin escribir
+// su declaracion). Devuelve su posicion, y si se agrego en 'nuevo'.
+static AliasDeclarado* agregar_alias(EscritorBinario* escritor,
+	char const* texto, int largo, int* nuevo) {
+	if (2 * (escritor->cantidadAlias + 1) > escritor->capacidadAlias)
+		agrandar_alias(escritor);
+	AliasDeclarado* posicion = buscar_alias(escritor, texto, largo);
+	*nuevo = posicion->texto == NULL;
+	if (*nuevo) {
+		posicion->texto = malloc(largo);
+		assert(posicion->texto);
+		memcpy(posicion->texto, texto, largo);
+		posicion->largo = largo;
+		posicion->numero = escritor->cantidadAlias++;
+	}
+	return posicion;
+}
+
+// Devuelve el numero del alias, declarandolo si todavia no lo esta.
+static int numero_alias(EscritorBinario* escritor, char const* texto,
+	int largo, uint32_t* numero) {
+	int nuevo;
+	AliasDeclarado* posicion = agregar_alias(escritor, texto, largo, &nuevo);
+	if (nuevo) {
+		comenzar_registro(escritor, B_ALIAS);
+		poner_bytes(escritor, texto, largo);
+		if (!terminar_registro(escritor))
+			return 0;
+	}
+	*numero = posicion->numero;
+	return 1;
+}
+
+// Escribe una carga, declarando antes los alias que use. Si la carga fue
+// perezosa, escribe el texto de su expresion, sin declarar sus alias.
+static int escribir_carga(EscritorBinario* escritor, Sentencia sentencia) {
+	Expresion* expresion = sentencia.expresion;
+	uint32_t alias;
+	if (!numero_alias(escritor, sentencia.alias, sentencia.alias_n, &alias))
+		return 0;
+	if (expresion == NULL) {
+		comenzar_registro(escritor, B_CARGA_FUENTE);
+		poner_varint(escritor, alias);
+		poner_bytes(escritor, sentencia.fuente, strlen(sentencia.fuente));
+		return terminar_registro(escritor);
+	}
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		uint32_t numero;
+		if (nodo->tag == X_ALIAS &&
+			!numero_alias(escritor, nodo->alias, nodo->valor, &numero))
+			return 0;
+	}
+
+	comenzar_registro(escritor, B_CARGA);
+	poner_varint(escritor, alias);
+	poner_varint(escritor, expresion->n);
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		uint32_t numero;
+		switch (nodo->tag) {
+		case X_NUMERO:
+			poner_varint(escritor, BINARIO_NUMERO);
+			// zigzag: los negativos van a los impares.
+			poner_varint(escritor, ((uint32_t)nodo->valor << 1) ^
+				(nodo->valor < 0 ? UINT32_MAX : 0));
+			break;
+		case X_ALIAS:
+			numero_alias(escritor, nodo->alias, nodo->valor, &numero);
+			poner_varint(escritor, BINARIO_ALIAS);
+			poner_varint(escritor, numero);
+			break;
+		case X_OPERACION:
+			// Los operadores se declaran en el orden de la tabla.
+			poner_varint(escritor, BINARIO_OPERADOR + nodo->op);
+			break;
+		}
+	}
+	return terminar_registro(escritor);
+}
+
+// Escribe una sentencia cuyo unico argumento es un alias.
+static int escribir_sentencia_alias(EscritorBinario* escritor,
+	RegistroBinario tipo, Sentencia sentencia) {
+	uint32_t alias;
+	if (!numero_alias(escritor, sentencia.alias, sentencia.alias_n, &alias))
+		return 0;
+	comenzar_registro(escritor, tipo);
+	poner_varint(escritor, alias);
+	return terminar_registro(escritor);
+}
+
+// Escribe una especializacion: el alias y sus alias variables.
+static int escribir_especializar(EscritorBinario* escritor,
+	Sentencia sentencia) {
+	Expresion const* variables = sentencia.expresion;
+	uint32_t alias;
+	if (!numero_alias(escritor, sentencia.alias, sentencia.alias_n, &alias))
+		return 0;
+	for (int i = 0; i < variables->n; ++i) {
+		uint32_t numero;
+		if (!numero_alias(escritor, variables->nodos[i].alias,
+			variables->nodos[i].valor, &numero))
+			return 0;
+	}
+
+	comenzar_registro(escritor, B_ESPECIALIZAR);
+	poner_varint(escritor, alias);
+	for (int i = 0; i < variables->n; ++i) {
+		uint32_t numero;
+		numero_alias(escritor, variables->nodos[i].alias,
+			variables->nodos[i].valor, &numero);
+		poner_varint(escritor, numero);
+	}
+	return terminar_registro(escritor);
+}
+
+EscritorBinario escritor_binario_crear(FILE* salida) {
+	return (EscritorBinario){ .salida = salida };
+}
+
+int binario_escribir_cabecera(EscritorBinario* escritor, TablaOps* tablaOps) {
+	if (escritor->salida == NULL)
+		agregar_bytes(&escritor->bytes, &escritor->cantidadBytes,
+			&escritor->capacidadBytes, BINARIO_MARCA, BINARIO_MARCA_N);
+	else if (fwrite(BINARIO_MARCA, 1, BINARIO_MARCA_N, escritor->salida) !=
+		BINARIO_MARCA_N)
+		return 0;
+
+	// Declaramos los operadores en el orden de la tabla, asi el numero de cada
+	// uno coincide con su id.
+	for (int i = 0; i < tablaOps->cantidad; ++i) {
+		char const* simbolo = tablaOps->entradas[i].simbolo;
+		comenzar_registro(escritor, B_OPERADOR);
+		poner_bytes(escritor, simbolo, strlen(simbolo));
+		if (!terminar_registro(escritor))
+			return 0;
+	}
+	return 1;
+}
+
+int binario_declarar_alias(EscritorBinario* escritor, char const* alias,
+	int alias_n, int escribir) {
+	if (escribir) {
+		uint32_t numero;
+		return numero_alias(escritor, alias, alias_n, &numero);
+	}
+	int nuevo;
+	agregar_alias(escritor, alias, alias_n, &nuevo);
+	return 1;
+}
+
+int binario_escribir(EscritorBinario* escritor, Parseado parseado) {
+	Sentencia sentencia = parseado.sentencia;
+	unsigned char error = parseado.error;
+	switch (sentencia.tag) {
+	case S_CARGA:
+		return escribir_carga(escritor, sentencia);
+	case S_EVALUAR:
+		return escribir_sentencia_alias(escritor, B_EVALUAR, sentencia);
+	case S_IMPRIMIR:
+		return escribir_sentencia_alias(escritor, B_IMPRIMIR, sentencia);
+	case S_OBSERVAR:
+		return escribir_sentencia_alias(escritor, B_OBSERVAR, sentencia);
+	case S_MOSTRAR:
+		return escribir_sentencia_alias(escritor, B_MOSTRAR, sentencia);
+	case S_SALIR:
+		comenzar_registro(escritor, B_SALIR);
+		return terminar_registro(escritor);
+	case S_EVALUAR_TODOS:
+		comenzar_registro(escritor, B_EVALUAR_TODOS);
+		return terminar_registro(escritor);
+	case S_INSTANTANEA:
+		comenzar_registro(escritor, B_INSTANTANEA);
+		return terminar_registro(escritor);
+	case S_RESTAURAR:
+		comenzar_registro(escritor, B_RESTAURAR);
+		poner_varint(escritor, sentencia.numero);
+		return terminar_registro(escritor);
+	case S_BORRAR:
+		return escribir_sentencia_alias(escritor, B_BORRAR, sentencia);
+	case S_MEMORIA:
+		comenzar_registro(escritor, B_MEMORIA);
+		return terminar_registro(escritor);
+	case S_ESPECIALIZAR:
+		return escribir_especializar(escritor, sentencia);
+	case S_INVALIDO:
+		comenzar_registro(escritor, B_INVALIDO);
+		poner_bytes(escritor, &error, 1);
+		poner_bytes(escritor, parseado.resto, strlen(parseado.resto));
+		return terminar_registro(escritor);
+	}
+	return 0;
+}
+
+void escritor_binario_limpiar(EscritorBinario* escritor) {
+	for (uint32_t i = 0; i < escritor->capacidadAlias; ++i)
+		free(escritor->alias[i].texto);
+	free(escritor->alias);
+	free(escritor->registro);
+	free(escritor->bytes);
+	*escritor = escritor_binario_crear(NULL);
+}
+
+int binario_convertir(TablaOps* tablaOps, FILE* entrada, FILE* salida) {
+	EscritorBinario escritor = escritor_binario_crear(salida);
+	int ok = binario_escribir_cabecera(&escritor, tablaOps);
+
+	char* linea = NULL;
+	size_t capacidad = 0;
+	ssize_t largo;
+	while (ok && (largo = getline(&linea, &capacidad, entrada)) != -1) {
+		if (largo > 0 && linea[largo - 1] == '\n')
+			linea[largo - 1] = '\0';
+		Parseado parseado = parsear(linea, tablaOps, 0, 1, NULL);
+		ok = binario_escribir(&escritor, parseado);
+		if (parseado.sentencia.tag == S_CARGA ||
+			parseado.sentencia.tag == S_ESPECIALIZAR)
+			expresion_limpiar(parseado.sentencia.expresion);
+	}
+
+	free(linea);
+	escritor_binario_limpiar(&escritor);
+	return ok;
+}
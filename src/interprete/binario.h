@@ -0,0 +1,168 @@
+#ifndef BINARIO_H
+#define BINARIO_H
+
+#include "../tabla_ops.h"
+#include "parser.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Formato binario de sentencias, para entradas generadas por programas: evita
+// el tokenizado del texto.
+//
+// El archivo empieza con la marca BINARIO_MARCA, seguida de una secuencia de
+// registros. Cada registro es su largo en bytes (un varint) y su contenido,
+// cuyo primer byte es un RegistroBinario. Los enteros se guardan como varints
+// (LEB128: 7 bits por byte, el bit alto indica que sigue otro byte), y los
+// numeros de las expresiones, ademas, en zigzag (para que los negativos chicos
+// ocupen pocos bytes).
+//
+// Los alias y los operadores se declaran una vez, con su texto, y luego se
+// referencian por su numero de declaracion (empezando en 0). Los operadores se
+// buscan por simbolo en la tabla del interprete, por lo que un archivo no
+// depende del orden de la tabla con el que se genero.
+
+#define BINARIO_MARCA "\xED" "EDB1"
+#define BINARIO_MARCA_N 5
+
+typedef enum {
+	B_ALIAS,     // texto del alias.
+	B_OPERADOR,  // simbolo del operador.
+	B_CARGA,     // alias, cantidad de nodos, nodos (en orden postfijo).
+	B_EVALUAR,   // alias.
+	B_IMPRIMIR,  // alias.
+	B_OBSERVAR,  // alias.
+	B_MOSTRAR,   // alias.
+	B_SALIR,     // (nada).
+	B_INVALIDO,  // ErrorTag (un byte), y el resto del texto de la sentencia.
+	B_EVALUAR_TODOS, // (nada).
+	B_INSTANTANEA,   // (nada).
+	B_RESTAURAR,     // numero de instantanea.
+	B_BORRAR,        // alias.
+	B_MEMORIA,       // (nada).
+	B_ESPECIALIZAR,  // alias, y los alias variables (hasta el final).
+	B_CARGA_FUENTE,  // alias, y el texto de la expresion (hasta el final).
+} RegistroBinario;
+
+// Una carga perezosa (ver 'parsear') se escribe como B_CARGA_FUENTE, con el
+// texto de su expresion, para no tener que armarla: se arma al leerla (o al
+// usarla, si la lectura tambien es perezosa).
+//
+// Cada nodo de una carga empieza con un varint: 0 indica un numero (le sigue
+// su valor), 1 un alias (le sigue su numero) y 2 + k el operador numero k.
+#define BINARIO_NUMERO 0
+#define BINARIO_ALIAS 1
+#define BINARIO_OPERADOR 2
+
+// Estado de la lectura de un archivo binario: los alias y operadores
+// declarados hasta el momento, y el buffer del ultimo registro leido.
+typedef struct {
+	char** alias;
+	int* largos;
+	int cantidadAlias;
+	int capacidadAlias;
+	EntradaTablaOps** ops; // NULL si el operador no esta en la tabla.
+	int cantidadOps;
+	int capacidadOps;
+	unsigned char* buffer;
+	size_t capacidadBuffer;
+} LectorBinario;
+
+/**
+ * Devuelve 1 si la entrada empieza con BINARIO_MARCA, consumiendo la marca.
+ * Si el primer byte no es el de la marca, no consume nada y devuelve 0. Si lo
+ * es, pero el resto no coincide, devuelve -1 (la entrada no es texto valido ni
+ * formato binario, y ya se consumieron hasta BINARIO_MARCA_N bytes).
+ */
+int binario_detectar(FILE* entrada);
+
+/**
+ * Devuelve un lector sin declaraciones.
+ */
+LectorBinario lector_binario_crear(void);
+
+/**
+ * Lee registros hasta encontrar una sentencia, y la devuelve en 'parseado',
+ * igual que 'parsear' (las declaraciones se procesan en el camino). Devuelve 0
+ * si la entrada termino.
+ * Los alias de la sentencia, y los de los nodos de su expresion, apuntan a
+ * memoria del lector, que vive hasta 'lector_binario_limpiar'. El resto de un
+ * parseado invalido vive hasta la siguiente lectura.
+ * Una carga B_CARGA_FUENTE se devuelve como una carga perezosa: su expresion
+ * se valida pero no se arma (queda en NULL), y 'sentencia.fuente' apunta a su
+ * texto, que tambien vive hasta la siguiente lectura.
+ **
+ * # uso de memoria:
+ * si la sentencia es S_CARGA o S_ESPECIALIZAR, se debe limpiar la
+ * sentencia.expresion (si no es NULL).
+ */
+int binario_leer(LectorBinario* lector, FILE* entrada, TablaOps* tablaOps,
+	Parseado* parseado);
+
+/**
+ * Libera el espacio de memoria ocupado por el lector.
+ */
+void lector_binario_limpiar(LectorBinario* lector);
+
+typedef struct AliasDeclarado AliasDeclarado;
+
+// Estado de la escritura de un archivo binario: los alias declarados hasta el
+// momento, y el registro que se esta armando. Si 'salida' es NULL, los
+// registros se acumulan en 'bytes' (el usuario puede vaciarlos poniendo
+// 'cantidadBytes' en 0).
+typedef struct {
+	FILE* salida;
+	unsigned char* bytes;
+	size_t cantidadBytes;
+	size_t capacidadBytes;
+	AliasDeclarado* alias;
+	uint32_t cantidadAlias;
+	uint32_t capacidadAlias; // potencia de 2.
+	unsigned char* registro;
+	size_t largo;
+	size_t capacidad;
+} EscritorBinario;
+
+/**
+ * Devuelve un escritor sin declaraciones, que escribe en 'salida' (o en sus
+ * bytes, si es NULL).
+ */
+EscritorBinario escritor_binario_crear(FILE* salida);
+
+/**
+ * Escribe la marca BINARIO_MARCA, y declara los operadores de la tabla en
+ * orden, por lo que el numero de cada uno es su id. Devuelve 0 si hubo un
+ * error al escribir.
+ */
+int binario_escribir_cabecera(EscritorBinario* escritor, TablaOps* tablaOps);
+
+/**
+ * Declara el alias, si todavia no lo esta. Si 'escribir' es 0, solo lo agrega
+ * a los declarados, para seguir escribiendo un archivo que ya lo declaro (en
+ * el mismo orden). Devuelve 0 si hubo un error al escribir.
+ */
+int binario_declarar_alias(EscritorBinario* escritor, char const* alias,
+	int alias_n, int escribir);
+
+/**
+ * Escribe el registro de la sentencia parseada, declarando antes los alias que
+ * use. Una carga sin expresion armada se escribe con su 'fuente'. Devuelve 0
+ * si hubo un error al escribir.
+ */
+int binario_escribir(EscritorBinario* escritor, Parseado parseado);
+
+/**
+ * Libera el espacio de memoria ocupado por el escritor.
+ */
+void escritor_binario_limpiar(EscritorBinario* escritor);
+
+/**
+ * Convierte las sentencias de texto de 'entrada' (una por linea) al formato
+ * binario, y las escribe en 'salida'. Las sentencias invalidas se guardan
+ * como registros B_INVALIDO, para que el interprete informe el mismo error.
+ * Devuelve 0 si hubo un error al escribir.
+ */
+int binario_convertir(TablaOps* tablaOps, FILE* entrada, FILE* salida);
+
+#endif // BINARIO_H
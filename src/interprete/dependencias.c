@@ -0,0 +1,260 @@
+#include "dependencias.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct AristaDependencias AristaDependencias;
+
+// Indica que el alias 'usuario' usa el nombre 'usado'.
+struct AristaDependencias {
+	VerticeDependencias* usado;
+	VerticeDependencias* usuario;
+	// vecinas en la lista de usuarios de 'usado' (doblemente enlazada).
+	AristaDependencias* anterior;
+	AristaDependencias* siguiente;
+	// siguiente en la lista de nombres usados por 'usuario'.
+	AristaDependencias* siguienteUsado;
+};
+
+struct VerticeDependencias {
+	VerticeDependencias* siguienteCubeta;
+	uint32_t hash;
+	char* alias;
+	int alias_n;
+	AristaDependencias* usuarios; // aristas de los alias que usan el nombre.
+	AristaDependencias* usados;   // aristas de los nombres que usa el alias.
+	void* dato;
+	int recorrido; // ultimo recorrido (o definicion) que lo marco.
+};
+
+// Funcion de hash FNV-1a.
+static uint32_t hash_nombre(char const* alias, int alias_n) {
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < alias_n; ++i)
+		h = (h ^ (unsigned char)alias[i]) * 16777619u;
+	return h;
+}
+
+// Devuelve el enlace que apunta al vertice del nombre, o al final de su
+// cubeta si no esta.
+static VerticeDependencias** enlace_de(Dependencias* dependencias,
+	char const* alias, int alias_n, uint32_t hash) {
+	VerticeDependencias** enlace =
+		&dependencias->cubetas[hash & (dependencias->cantidadCubetas - 1)];
+	while (*enlace && ((*enlace)->hash != hash || (*enlace)->alias_n != alias_n ||
+		memcmp((*enlace)->alias, alias, alias_n) != 0))
+		enlace = &(*enlace)->siguienteCubeta;
+	return enlace;
+}
+
+// Devuelve el vertice del nombre, o NULL si no esta.
+static VerticeDependencias* vertice_buscar(Dependencias* dependencias,
+	char const* alias, int alias_n) {
+	if (dependencias->cantidad == 0)
+		return NULL;
+	return *enlace_de(dependencias, alias, alias_n, hash_nombre(alias, alias_n));
+}
+
+// Duplica la cantidad de cubetas (o crea las primeras), redistribuyendo los
+// vertices.
+static void cubetas_crecer(Dependencias* dependencias) {
+	int cantidad = dependencias->cantidadCubetas ?
+		2 * dependencias->cantidadCubetas : 64;
+	VerticeDependencias** cubetas = calloc(cantidad, sizeof(*cubetas));
+	assert(cubetas);
+	for (int i = 0; i < dependencias->cantidadCubetas; ++i) {
+		VerticeDependencias* vertice = dependencias->cubetas[i];
+		while (vertice) {
+			VerticeDependencias* siguiente = vertice->siguienteCubeta;
+			VerticeDependencias** cubeta = &cubetas[vertice->hash & (cantidad - 1)];
+			vertice->siguienteCubeta = *cubeta;
+			*cubeta = vertice;
+			vertice = siguiente;
+		}
+	}
+	free(dependencias->cubetas);
+	dependencias->cubetas = cubetas;
+	dependencias->cantidadCubetas = cantidad;
+}
+
+// Devuelve el vertice del nombre, creandolo si no esta.
+static VerticeDependencias* vertice_obtener(Dependencias* dependencias,
+	char const* alias, int alias_n) {
+	if (dependencias->cantidad >= dependencias->cantidadCubetas)
+		cubetas_crecer(dependencias);
+	uint32_t hash = hash_nombre(alias, alias_n);
+	VerticeDependencias** enlace = enlace_de(dependencias, alias, alias_n, hash);
+	if (*enlace)
+		return *enlace;
+	VerticeDependencias* vertice = malloc(sizeof(*vertice));
+	assert(vertice);
+	*vertice = (VerticeDependencias){
+		.hash = hash,
+		.alias = malloc(alias_n),
+		.alias_n = alias_n,
+	};
+	assert(vertice->alias);
+	memcpy(vertice->alias, alias, alias_n);
+	*enlace = vertice;
+	dependencias->cantidad += 1;
+	dependencias->bytes += sizeof(*vertice) + alias_n;
+	return vertice;
+}
+
+// Libera el vertice si no tiene aristas ni dato. Sin vertices, el indice
+// tampoco retiene sus cubetas ni su pila.
+static void vertice_liberar_si_vacio(Dependencias* dependencias,
+	VerticeDependencias* vertice) {
+	if (vertice->usuarios || vertice->usados || vertice->dato)
+		return;
+	VerticeDependencias** enlace = enlace_de(dependencias, vertice->alias,
+		vertice->alias_n, vertice->hash);
+	*enlace = vertice->siguienteCubeta;
+	dependencias->bytes -= sizeof(*vertice) + vertice->alias_n;
+	free(vertice->alias);
+	free(vertice);
+	if (--dependencias->cantidad == 0)
+		dependencias_limpiar(dependencias);
+}
+
+// Quita las aristas de los nombres que usa el alias del vertice, y libera los
+// nombres que quedan sin aristas (salvo el propio vertice).
+static void quitar_usados(Dependencias* dependencias,
+	VerticeDependencias* vertice) {
+	AristaDependencias* arista = vertice->usados;
+	vertice->usados = NULL;
+	while (arista) {
+		AristaDependencias* siguiente = arista->siguienteUsado;
+		VerticeDependencias* usado = arista->usado;
+		if (arista->anterior)
+			arista->anterior->siguiente = arista->siguiente;
+		else
+			usado->usuarios = arista->siguiente;
+		if (arista->siguiente)
+			arista->siguiente->anterior = arista->anterior;
+		free(arista);
+		dependencias->bytes -= sizeof(*arista);
+		// Cada nombre aparece una sola vez entre los usados.
+		if (usado != vertice)
+			vertice_liberar_si_vacio(dependencias, usado);
+		arista = siguiente;
+	}
+}
+
+Dependencias dependencias_crear(void) {
+	return (Dependencias){0};
+}
+
+void dependencias_definir(Dependencias* dependencias, char const* alias,
+	int alias_n, Expresion* expresion) {
+	VerticeDependencias* vertice = expresion ?
+		vertice_obtener(dependencias, alias, alias_n) :
+		vertice_buscar(dependencias, alias, alias_n);
+	if (vertice == NULL)
+		return;
+	quitar_usados(dependencias, vertice);
+	// Marcamos los nombres ya agregados, para no repetir aristas.
+	dependencias->recorrido += 1;
+	for (int i = 0; expresion && i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (nodo->tag != X_ALIAS)
+			continue;
+		VerticeDependencias* usado =
+			vertice_obtener(dependencias, nodo->alias, nodo->valor);
+		if (usado->recorrido == dependencias->recorrido)
+			continue;
+		usado->recorrido = dependencias->recorrido;
+		AristaDependencias* arista = malloc(sizeof(*arista));
+		assert(arista);
+		*arista = (AristaDependencias){
+			.usado = usado,
+			.usuario = vertice,
+			.siguiente = usado->usuarios,
+			.siguienteUsado = vertice->usados,
+		};
+		if (usado->usuarios)
+			usado->usuarios->anterior = arista;
+		usado->usuarios = arista;
+		vertice->usados = arista;
+		dependencias->bytes += sizeof(*arista);
+	}
+	vertice_liberar_si_vacio(dependencias, vertice);
+}
+
+void dependencias_asociar(Dependencias* dependencias, char const* alias,
+	int alias_n, void* dato) {
+	VerticeDependencias* vertice = dato ?
+		vertice_obtener(dependencias, alias, alias_n) :
+		vertice_buscar(dependencias, alias, alias_n);
+	if (vertice == NULL)
+		return;
+	vertice->dato = dato;
+	vertice_liberar_si_vacio(dependencias, vertice);
+}
+
+void dependencias_recorrer(Dependencias* dependencias, char const* alias,
+	int alias_n, VisitarDependiente visitar, void* datos) {
+	VerticeDependencias* vertice =
+		vertice_buscar(dependencias, alias, alias_n);
+	// Un nombre sin vertice no tiene dependientes.
+	if (vertice == NULL) {
+		visitar(datos, alias, alias_n, NULL);
+		return;
+	}
+	dependencias->recorrido += 1;
+	vertice->recorrido = dependencias->recorrido;
+	int tope = 0;
+	if (dependencias->capacidadPila == 0) {
+		dependencias->capacidadPila = 64;
+		dependencias->pila = malloc(64 * sizeof(*dependencias->pila));
+		assert(dependencias->pila);
+	}
+	dependencias->pila[tope++] = vertice;
+	while (tope > 0) {
+		VerticeDependencias* actual = dependencias->pila[--tope];
+		visitar(datos, actual->alias, actual->alias_n, actual->dato);
+		for (AristaDependencias* it = actual->usuarios; it; it = it->siguiente) {
+			VerticeDependencias* usuario = it->usuario;
+			if (usuario->recorrido == dependencias->recorrido)
+				continue;
+			usuario->recorrido = dependencias->recorrido;
+			if (tope == dependencias->capacidadPila) {
+				dependencias->capacidadPila *= 2;
+				dependencias->pila = realloc(dependencias->pila,
+					dependencias->capacidadPila * sizeof(*dependencias->pila));
+				assert(dependencias->pila);
+			}
+			dependencias->pila[tope++] = usuario;
+		}
+	}
+}
+
+size_t dependencias_memoria(Dependencias* dependencias) {
+	return dependencias->bytes +
+		dependencias->cantidadCubetas * sizeof(*dependencias->cubetas) +
+		dependencias->capacidadPila * sizeof(*dependencias->pila);
+}
+
+void dependencias_limpiar(Dependencias* dependencias) {
+	for (int i = 0; i < dependencias->cantidadCubetas; ++i) {
+		VerticeDependencias* vertice = dependencias->cubetas[i];
+		while (vertice) {
+			VerticeDependencias* siguiente = vertice->siguienteCubeta;
+			// Cada arista esta en la lista de usados de un solo vertice.
+			AristaDependencias* arista = vertice->usados;
+			while (arista) {
+				AristaDependencias* sig = arista->siguienteUsado;
+				free(arista);
+				arista = sig;
+			}
+			free(vertice->alias);
+			free(vertice);
+			vertice = siguiente;
+		}
+	}
+	free(dependencias->cubetas);
+	free(dependencias->pila);
+	*dependencias = dependencias_crear();
+}
@@ -0,0 +1,76 @@
+#ifndef DEPENDENCIAS_H
+#define DEPENDENCIAS_H
+
+#include "expresion.h"
+
+#include <stddef.h>
+
+// Indice inverso de las dependencias entre alias: para cada nombre, los alias
+// cuya expresion lo usa (aunque el nombre todavia no este definido). Permite
+// hallar los alias afectados por un cambio recorriendo solo esos alias, en
+// lugar de recorrer el grafo desde cada alias que podria estar afectado.
+//
+// Cada nombre es un vertice, con una copia del nombre (los alias de las
+// entradas pueden liberarse antes), la lista de aristas hacia los alias que lo
+// usan y la de aristas hacia los nombres que usa. Una arista esta en las dos
+// listas, por lo que quitar las dependencias de un alias cuesta tiempo lineal
+// en la cantidad de nombres que usa. Los vertices sin aristas ni dato asociado
+// se liberan.
+
+typedef struct VerticeDependencias VerticeDependencias;
+
+typedef struct {
+	VerticeDependencias** cubetas; // tabla de hash, con listas enlazadas.
+	int cantidadCubetas;
+	int cantidad;    // cantidad de vertices.
+	int recorrido;   // numero del ultimo recorrido (ver 'dependencias_recorrer').
+	// pila de vertices por visitar, que se reutiliza entre recorridos.
+	VerticeDependencias** pila;
+	int capacidadPila;
+	size_t bytes;    // memoria ocupada por los vertices y las aristas.
+} Dependencias;
+
+// Funcion que se llama con cada alias afectado por un cambio. 'dato' es el
+// asociado al alias con 'dependencias_asociar' (NULL si no hay).
+typedef void (*VisitarDependiente)(void* datos, char const* alias,
+	int alias_n, void* dato);
+
+/**
+ * Devuelve un indice vacio.
+ */
+Dependencias dependencias_crear(void);
+
+/**
+ * Reemplaza los nombres que usa el alias por los alias de la expresion. Si la
+ * expresion es NULL (porque el alias se borro, o todavia no se armo), el alias
+ * queda sin dependencias.
+ */
+void dependencias_definir(Dependencias* dependencias, char const* alias,
+	int alias_n, Expresion* expresion);
+
+/**
+ * Asocia un dato al nombre, que se pasa al visitarlo. Mientras el dato no sea
+ * NULL, el vertice no se libera.
+ */
+void dependencias_asociar(Dependencias* dependencias, char const* alias,
+	int alias_n, void* dato);
+
+/**
+ * Visita, una sola vez cada uno, el alias y todos los alias que dependen de
+ * el, directa o indirectamente. Cuesta tiempo lineal en la cantidad de alias
+ * visitados y de sus aristas.
+ */
+void dependencias_recorrer(Dependencias* dependencias, char const* alias,
+	int alias_n, VisitarDependiente visitar, void* datos);
+
+/**
+ * Devuelve los bytes que ocupa el indice.
+ */
+size_t dependencias_memoria(Dependencias* dependencias);
+
+/**
+ * Libera todos los vertices y aristas, y deja el indice vacio.
+ */
+void dependencias_limpiar(Dependencias* dependencias);
+
+#endif // DEPENDENCIAS_H
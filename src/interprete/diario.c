@@ -0,0 +1,436 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "diario.h"
+
+#include "expresion.h"
+#include "tabla_alias.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// Cantidad de registros, ademas del doble de los alias vivos, que se agregan al
+// diario antes de compactarlo.
+#define DIARIO_MINIMO 4096
+
+struct Diario {
+	char* ruta;
+	char* temporal; // donde se escribe el diario compactado.
+	TablaOps* ops;
+	// Del hilo de la sesion: codifica los registros, y cuenta los que se
+	// agregaron desde que se pidio la ultima compactacion.
+	EscritorBinario escritor;
+	long long registros;
+	// Del hilo escritor.
+	pthread_t escritorHilo;
+	int fd;
+	off_t tamano;       // bytes escritos en el diario.
+	pthread_t compactador;
+	off_t hasta;        // bytes del diario que se estan compactando.
+	// Compartidos, protegidos por 'mutex'.
+	pthread_mutex_t mutex;
+	pthread_cond_t cambio;
+	unsigned char* pendientes; // registros que falta escribir.
+	size_t cantidadPendientes;
+	size_t capacidadPendientes;
+	int compactar;   // si la sesion pidio compactar.
+	int compactando; // si hay un compactador corriendo.
+	int compactado;  // 1 si el compactador termino bien, -1 si fallo.
+	int cerrar;
+	// si hubo un error al escribir: el diario se corta en el ultimo lote que
+	// se escribio completo, y no se le agrega nada mas.
+	int fallo;
+};
+
+// Escribe todos los bytes en el archivo. Devuelve 0 si hubo un error.
+static int escribir_todo(int fd, unsigned char const* bytes, size_t n) {
+	while (n > 0) {
+		ssize_t escritos = write(fd, bytes, n);
+		if (escritos < 0 && errno == EINTR)
+			continue;
+		if (escritos <= 0)
+			return 0;
+		bytes += escritos;
+		n -= escritos;
+	}
+	return 1;
+}
+
+// Confirma en el disco el directorio del archivo, para que su creacion o un
+// 'rename' sobre el sobrevivan a una caida. Devuelve 0 si hubo un error.
+static int sincronizar_directorio(char const* ruta) {
+	char const* barra = strrchr(ruta, '/');
+	char* directorio = barra == NULL ? strdup(".") :
+		barra == ruta ? strdup("/") : strndup(ruta, barra - ruta);
+	assert(directorio);
+	int fd = open(directorio, O_RDONLY);
+	free(directorio);
+	if (fd < 0)
+		return 0;
+	// Algunos sistemas de archivos no sincronizan directorios.
+	int ok = fsync(fd) == 0 || errno == EINVAL;
+	close(fd);
+	return ok;
+}
+
+// Escribe en 'temporal' lo que queda vivo de los primeros 'hasta' bytes del
+// diario: las declaraciones de alias (en el mismo orden, para que conserven su
+// numero) y la ultima carga de cada alias que no se borro, en orden de
+// definicion. Devuelve 0 si hubo un error.
+static int compactar_archivo(char const* ruta, char const* temporal,
+	off_t hasta, TablaOps* tablaOps) {
+	FILE* entrada = fopen(ruta, "rb");
+	if (entrada == NULL)
+		return 0;
+	if (binario_detectar(entrada) != 1) {
+		fclose(entrada);
+		return 0;
+	}
+	// Las sentencias no cruzan 'hasta', que es el final de un lote.
+	LectorBinario lector = lector_binario_crear();
+	TablaAlias vivos = ta_crear();
+	Parseado parseado;
+	while (ftello(entrada) < hasta &&
+		binario_leer(&lector, entrada, tablaOps, &parseado)) {
+		Sentencia sentencia = parseado.sentencia;
+		// El texto de una carga perezosa es del buffer del lector: la entrada
+		// se queda con una copia, y se reescribe como texto.
+		char* input = NULL;
+		if (sentencia.tag == S_CARGA && sentencia.expresion == NULL) {
+			input = strdup(sentencia.fuente);
+			assert(input);
+		}
+		if (sentencia.tag == S_CARGA)
+			ta_insertar_o_reemplazar(&vivos, (EntradaTablaAlias){
+				.input = input,
+				.alias = sentencia.alias,
+				.alias_n = sentencia.alias_n,
+				.expresion = sentencia.expresion,
+				.fuente = input,
+			});
+		else if (sentencia.tag == S_BORRAR)
+			ta_borrar(&vivos, sentencia.alias, sentencia.alias_n);
+		else if (sentencia.tag == S_ESPECIALIZAR)
+			expresion_limpiar(sentencia.expresion);
+	}
+	fclose(entrada);
+
+	FILE* salida = fopen(temporal, "wb");
+	EscritorBinario escritor = escritor_binario_crear(salida);
+	int ok = salida != NULL && binario_escribir_cabecera(&escritor, tablaOps);
+	for (int i = 0; ok && i < lector.cantidadAlias; ++i)
+		ok = binario_declarar_alias(&escritor, lector.alias[i], lector.largos[i],
+			1);
+	EntradaTablaAlias** entradas = malloc((vivos.cantidad + 1) *
+		sizeof(EntradaTablaAlias*));
+	assert(entradas);
+	ta_listar(&vivos, entradas);
+	for (int i = 0; ok && i < vivos.cantidad; ++i) {
+		Sentencia carga = {
+			.tag = S_CARGA,
+			.alias = entradas[i]->alias,
+			.alias_n = entradas[i]->alias_n,
+			.expresion = entradas[i]->expresion,
+			.fuente = entradas[i]->fuente,
+		};
+		ok = binario_escribir(&escritor, (Parseado){"", carga, 0});
+	}
+	free(entradas);
+	if (salida != NULL) {
+		ok = ok && fflush(salida) == 0 && fsync(fileno(salida)) == 0;
+		if (fclose(salida) != 0)
+			ok = 0;
+	}
+	escritor_binario_limpiar(&escritor);
+	// Los alias de la tabla apuntan al lector, por lo que la limpiamos antes.
+	ta_limpiar(&vivos);
+	lector_binario_limpiar(&lector);
+	return ok;
+}
+
+// Cuerpo del compactador: compacta los primeros 'hasta' bytes del diario, y
+// avisa al hilo escritor.
+static void* compactar(void* diario_) {
+	Diario* diario = diario_;
+	int ok = compactar_archivo(diario->ruta, diario->temporal, diario->hasta,
+		diario->ops);
+	pthread_mutex_lock(&diario->mutex);
+	diario->compactado = ok ? 1 : -1;
+	pthread_cond_signal(&diario->cambio);
+	pthread_mutex_unlock(&diario->mutex);
+	return NULL;
+}
+
+// Pone el diario compactado en lugar del diario, agregandole los registros que
+// se escribieron despues de 'hasta'. Devuelve 0 si hubo un error, en cuyo caso
+// se sigue usando el diario original.
+static int reemplazar_diario(Diario* diario) {
+	int fd = open(diario->temporal, O_RDWR | O_APPEND);
+	if (fd < 0)
+		return 0;
+	off_t tamano = lseek(fd, 0, SEEK_END);
+	int ok = tamano >= 0;
+	unsigned char bytes[1 << 16];
+	for (off_t p = diario->hasta; ok && p < diario->tamano; ) {
+		size_t n = diario->tamano - p < (off_t)sizeof(bytes) ?
+			(size_t)(diario->tamano - p) : sizeof(bytes);
+		ssize_t leidos = pread(diario->fd, bytes, n, p);
+		ok = leidos > 0 && escribir_todo(fd, bytes, leidos);
+		p += leidos;
+		tamano += leidos;
+	}
+	if (!ok || fsync(fd) != 0 || rename(diario->temporal, diario->ruta) != 0) {
+		close(fd);
+		return 0;
+	}
+	close(diario->fd);
+	diario->fd = fd;
+	diario->tamano = tamano;
+	return sincronizar_directorio(diario->ruta);
+}
+
+// Cuerpo del hilo escritor: escribe los registros pendientes de a lotes, y
+// lanza y termina las compactaciones, hasta que se cierra el diario.
+static void* escribir_lotes(void* diario_) {
+	Diario* diario = diario_;
+	unsigned char* lote = NULL;
+	size_t capacidadLote = 0;
+	pthread_mutex_lock(&diario->mutex);
+	while (1) {
+		// Terminar o empezar una compactacion tiene prioridad sobre los lotes,
+		// que pueden no dejar de llegar.
+		if (diario->compactado) {
+			int resultado = diario->compactado;
+			pthread_mutex_unlock(&diario->mutex);
+			pthread_join(diario->compactador, NULL);
+			if (resultado != 1 || !reemplazar_diario(diario))
+				unlink(diario->temporal);
+			pthread_mutex_lock(&diario->mutex);
+			diario->compactado = 0;
+			diario->compactando = 0;
+		}
+		else if (diario->compactar && !diario->compactando && !diario->fallo &&
+			diario->tamano > 0) {
+			// Compactamos lo escrito hasta ahora (al menos la cabecera, que va en
+			// el primer lote). Los lotes siguientes se agregan al diario mientras
+			// tanto, y se copian al terminar.
+			diario->compactar = 0;
+			diario->compactando = 1;
+			diario->hasta = diario->tamano;
+			int error = pthread_create(&diario->compactador, NULL, compactar,
+				diario);
+			assert(error == 0);
+			(void)error;
+		}
+		else if (diario->cantidadPendientes > 0 && diario->fallo)
+			// Despues de un error, los registros se descartan: agregarlos despues
+			// de uno perdido haria que se pierdan al reproducir el diario.
+			diario->cantidadPendientes = 0;
+		else if (diario->cantidadPendientes > 0) {
+			// Tomamos todos los registros pendientes: los que lleguen mientras
+			// esperamos al disco forman el proximo lote.
+			unsigned char* bytes = diario->pendientes;
+			size_t capacidad = diario->capacidadPendientes;
+			size_t n = diario->cantidadPendientes;
+			diario->pendientes = lote;
+			diario->capacidadPendientes = capacidadLote;
+			diario->cantidadPendientes = 0;
+			lote = bytes;
+			capacidadLote = capacidad;
+			pthread_mutex_unlock(&diario->mutex);
+			int ok = escribir_todo(diario->fd, lote, n) && fsync(diario->fd) == 0;
+			// Si el lote no se escribio completo, lo quitamos, para que el diario
+			// termine en un registro completo.
+			if (ok)
+				diario->tamano += n;
+			else if (ftruncate(diario->fd, diario->tamano) == 0)
+				fsync(diario->fd);
+			pthread_mutex_lock(&diario->mutex);
+			if (!ok)
+				diario->fallo = 1;
+		}
+		else if (diario->cerrar && !diario->compactando)
+			break;
+		else
+			pthread_cond_wait(&diario->cambio, &diario->mutex);
+	}
+	pthread_mutex_unlock(&diario->mutex);
+	free(lote);
+	return NULL;
+}
+
+// Pasa los registros codificados por la sesion al hilo escritor.
+static void enviar(Diario* diario, int compactar) {
+	EscritorBinario* escritor = &diario->escritor;
+	pthread_mutex_lock(&diario->mutex);
+	if (diario->cantidadPendientes == 0) {
+		// Intercambiamos los buffers, en lugar de copiar.
+		unsigned char* bytes = diario->pendientes;
+		size_t capacidad = diario->capacidadPendientes;
+		diario->pendientes = escritor->bytes;
+		diario->capacidadPendientes = escritor->capacidadBytes;
+		diario->cantidadPendientes = escritor->cantidadBytes;
+		escritor->bytes = bytes;
+		escritor->capacidadBytes = capacidad;
+	}
+	else {
+		size_t n = diario->cantidadPendientes + escritor->cantidadBytes;
+		if (n > diario->capacidadPendientes) {
+			while (n > diario->capacidadPendientes)
+				diario->capacidadPendientes *= 2;
+			diario->pendientes = realloc(diario->pendientes,
+				diario->capacidadPendientes);
+			assert(diario->pendientes);
+		}
+		memcpy(diario->pendientes + diario->cantidadPendientes, escritor->bytes,
+			escritor->cantidadBytes);
+		diario->cantidadPendientes = n;
+	}
+	escritor->cantidadBytes = 0;
+	if (compactar)
+		diario->compactar = 1;
+	pthread_cond_signal(&diario->cambio);
+	pthread_mutex_unlock(&diario->mutex);
+}
+
+// Libera el diario (sin su hilo escritor).
+static void diario_liberar(Diario* diario) {
+	escritor_binario_limpiar(&diario->escritor);
+	free(diario->pendientes);
+	free(diario->ruta);
+	free(diario->temporal);
+	free(diario);
+}
+
+Diario* diario_abrir(char const* ruta, TablaOps* tablaOps,
+	LectorBinario* lector, AplicarDiario aplicar, void* datos) {
+	// Reproducimos el diario, de existir. Recordamos donde termina la ultima
+	// sentencia completa, y cuantos alias se habian declarado hasta ahi: lo que
+	// sigue es lo que alcanzo a escribirse antes de una caida.
+	off_t fin = 0;
+	int declarados = 0;
+	long long registros = 0;
+	FILE* entrada = fopen(ruta, "rb");
+	if (entrada == NULL && errno != ENOENT)
+		return NULL;
+	if (entrada != NULL) {
+		char marca[BINARIO_MARCA_N];
+		size_t n = fread(marca, 1, BINARIO_MARCA_N, entrada);
+		// Un archivo con parte de la marca es un diario que no llego a empezar.
+		if (memcmp(marca, BINARIO_MARCA, n) != 0) {
+			fclose(entrada);
+			return NULL;
+		}
+		Parseado parseado;
+		while (n == BINARIO_MARCA_N &&
+			binario_leer(lector, entrada, tablaOps, &parseado)) {
+			aplicar(datos, parseado);
+			fin = ftello(entrada);
+			declarados = lector->cantidadAlias;
+			registros += 1;
+		}
+		fclose(entrada);
+	}
+
+	Diario* diario = calloc(1, sizeof(Diario));
+	assert(diario);
+	diario->ruta = strdup(ruta);
+	diario->temporal = malloc(strlen(ruta) + sizeof(".tmp"));
+	assert(diario->ruta && diario->temporal);
+	sprintf(diario->temporal, "%s.tmp", ruta);
+	diario->ops = tablaOps;
+	diario->escritor = escritor_binario_crear(NULL);
+	diario->registros = registros;
+
+	// Los registros nuevos numeran los operadores segun la tabla. Si el diario
+	// los declaro en otro orden, lo reescribimos compactado.
+	int ordenado = lector->cantidadOps == tablaOps->cantidad;
+	for (int i = 0; ordenado && i < lector->cantidadOps; ++i)
+		ordenado = lector->ops[i] == &tablaOps->entradas[i];
+	if (fin > 0 && !ordenado && (!compactar_archivo(ruta, diario->temporal,
+		fin, tablaOps) || rename(diario->temporal, ruta) != 0)) {
+		unlink(diario->temporal);
+		diario_liberar(diario);
+		return NULL;
+	}
+
+	diario->fd = open(ruta, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (diario->fd < 0 || !sincronizar_directorio(ruta)) {
+		if (diario->fd >= 0)
+			close(diario->fd);
+		diario_liberar(diario);
+		return NULL;
+	}
+	int ok = 1;
+	if (fin == 0) {
+		// No hay ninguna sentencia completa: empezamos el diario de cero.
+		ok = ftruncate(diario->fd, 0) == 0;
+		binario_escribir_cabecera(&diario->escritor, tablaOps);
+	}
+	else {
+		// Descartamos el registro incompleto del final, de haberlo (un diario
+		// reescrito no lo tiene).
+		if (ordenado)
+			ok = ftruncate(diario->fd, fin) == 0;
+		for (int i = 0; i < declarados; ++i)
+			binario_declarar_alias(&diario->escritor, lector->alias[i],
+				lector->largos[i], 0);
+	}
+	diario->tamano = lseek(diario->fd, 0, SEEK_END);
+	if (!ok || diario->tamano < 0) {
+		close(diario->fd);
+		diario_liberar(diario);
+		return NULL;
+	}
+
+	pthread_mutex_init(&diario->mutex, NULL);
+	pthread_cond_init(&diario->cambio, NULL);
+	int error = pthread_create(&diario->escritorHilo, NULL, escribir_lotes,
+		diario);
+	assert(error == 0);
+	(void)error;
+	if (diario->escritor.cantidadBytes > 0)
+		enviar(diario, 0);
+	return diario;
+}
+
+int diario_fallo(Diario* diario) {
+	pthread_mutex_lock(&diario->mutex);
+	int fallo = diario->fallo;
+	pthread_mutex_unlock(&diario->mutex);
+	return fallo;
+}
+
+void diario_registrar(Diario* diario, Sentencia sentencia, int vivos) {
+	if (diario_fallo(diario))
+		return;
+	// El escritor acumula en memoria, por lo que no puede fallar.
+	binario_escribir(&diario->escritor, (Parseado){"", sentencia, 0});
+	diario->registros += 1;
+	int compactar = diario->registros > 2LL * vivos + DIARIO_MINIMO;
+	// Despues de compactar, el diario tiene un registro por alias vivo.
+	if (compactar)
+		diario->registros = vivos;
+	enviar(diario, compactar);
+}
+
+int diario_cerrar(Diario* diario) {
+	pthread_mutex_lock(&diario->mutex);
+	diario->cerrar = 1;
+	pthread_cond_signal(&diario->cambio);
+	pthread_mutex_unlock(&diario->mutex);
+	pthread_join(diario->escritorHilo, NULL);
+	int ok = !diario->fallo;
+	if (close(diario->fd) != 0)
+		ok = 0;
+	pthread_mutex_destroy(&diario->mutex);
+	pthread_cond_destroy(&diario->cambio);
+	diario_liberar(diario);
+	return ok;
+}
@@ -0,0 +1,66 @@
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include "../tabla_ops.h"
+#include "binario.h"
+#include "parser.h"
+
+// Diario de las definiciones de una sesion, para recuperar los alias al
+// volver a empezar (o despues de una caida) sin parsear sus expresiones.
+// Las cargas perezosas se guardan con el texto de su expresion (ver
+// B_CARGA_FUENTE), por lo que registrarlas no las arma: se arman al
+// reproducir el diario, o al usarse si la sesion que lo reproduce tambien es
+// perezosa.
+//
+// El diario es un archivo en el formato binario (ver binario.h) que solo tiene
+// cargas y borrados, y al que solo se le agregan registros al final. Los
+// registros se escriben en un hilo aparte, que los junta en lotes: mientras
+// espera a que el disco confirme un lote (con fsync), los registros nuevos
+// forman el siguiente. Por esto, una definicion llega al disco a lo sumo un
+// lote despues de ejecutarse, y al cerrar el diario se espera a todas.
+//
+// Cuando el diario tiene muchos mas registros que alias vivos, otro hilo lo
+// compacta: reescribe en un archivo aparte la ultima definicion de cada alias,
+// y lo pone en lugar del diario con 'rename' (junto a los registros que se
+// agregaron mientras tanto). Las declaraciones de alias conservan su numero,
+// por lo que se puede seguir escribiendo sin interrupcion.
+
+typedef struct Diario Diario;
+
+// Funcion que aplica una sentencia leida del diario (S_CARGA o S_BORRAR) al
+// entorno de la sesion.
+typedef void (*AplicarDiario)(void* datos, Parseado parseado);
+
+/**
+ * Abre el diario en 'ruta', creandolo si no existe. Si ya existe, lee sus
+ * sentencias con 'lector' y las pasa a 'aplicar' (los alias apuntan a memoria
+ * del lector), y descarta el registro incompleto del final que pueda haber
+ * dejado una caida.
+ * Devuelve NULL si no se pudo abrir, o si el archivo no es un diario.
+ */
+Diario* diario_abrir(char const* ruta, TablaOps* tablaOps,
+	LectorBinario* lector, AplicarDiario aplicar, void* datos);
+
+/**
+ * Agrega la sentencia (S_CARGA, con su expresion armada o su fuente, o
+ * S_BORRAR) al diario.
+ * 'vivos' es la cantidad de alias definidos, para decidir cuando compactar.
+ * Si el diario fallo, no hace nada.
+ */
+void diario_registrar(Diario* diario, Sentencia sentencia, int vivos);
+
+/**
+ * Devuelve 1 si hubo un error al escribir el diario. En ese caso, el archivo
+ * termina en el ultimo lote que se escribio completo, y los registros
+ * siguientes se descartan.
+ */
+int diario_fallo(Diario* diario);
+
+/**
+ * Espera a que se escriban todos los registros (y a que termine la
+ * compactacion en curso), y libera el diario. Devuelve 0 si hubo un error al
+ * escribir.
+ */
+int diario_cerrar(Diario* diario);
+
+#endif // DIARIO_H
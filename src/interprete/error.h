@@ -9,7 +9,14 @@ typedef enum {
 	E_PARSER_OPERACION, 	// operacion invalida  
 	E_PARSER_VACIA, 			// expresion vacia
   E_PARSER_OPERADOR,
+	E_PARSER_NUMERO,      // se esperaba un numero
+	E_PARSER_VARIANDO,    // sintaxis en la especializacion
 	E_INTERPRETE_ALIAS,    // error en la evaluacion del alias
+	E_INTERPRETE_CICLO,    // el alias depende de si mismo
+	E_INTERPRETE_TAMANO,   // la expresion es demasiado grande para imprimirse
+	E_INTERPRETE_INSTANTANEA, // no existe la instantanea pedida
+	E_INTERPRETE_PRESUPUESTO, // la evaluacion excedio el presupuesto
+	E_INTERPRETE_RESIDUO,     // la expresion especializada es demasiado grande
 } ErrorTag;
 
 #endif // ERROR_H
\ No newline at end of file
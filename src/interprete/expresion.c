@@ -1,44 +1,84 @@
 #include "expresion.h"
 	
+#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include <stdlib.h>
-
-// Guarda la expresion en el heap y devuelve una referencia al bloque de memoria.
-static Expresion* expresion_reservar(Expresion datos) {
-	Expresion* resultado = malloc(sizeof(Expresion));
-	*resultado = datos;
+Expresion* expresion_crear(int capacidad) {
+	if (capacidad < 1)
+		capacidad = 1;
+	Expresion* resultado = 
+		malloc(sizeof(Expresion) + capacidad * sizeof(Nodo));
+	assert(resultado);
+	resultado->n = 0;
+	resultado->capacidad = capacidad;
 	return resultado;
 }
 
-Expresion* expresion_numero(int valor) {
-	return expresion_reservar((Expresion){
+// Duplica la capacidad de la expresion de ser necesario.
+void expresion_agregar(Expresion** expresion, Nodo nodo) {
+	Expresion* e = *expresion;
+	if (e->n == e->capacidad) {
+		e->capacidad *= 2;
+		e = realloc(e, sizeof(Expresion) + e->capacidad * sizeof(Nodo));
+		assert(e);
+		*expresion = e;
+	}
+	e->nodos[e->n++] = nodo;
+}
+
+void expresion_numero(Expresion** expresion, int valor) {
+	expresion_agregar(expresion, (Nodo){
 		.tag = X_NUMERO,
 		.valor = valor,
 	});
 }
 
-Expresion* expresion_alias(char const* alias, int alias_n) {
-	return expresion_reservar((Expresion){
+void expresion_alias(Expresion** expresion, char const* alias, int alias_n) {
+	expresion_agregar(expresion, (Nodo){
 		.tag = X_ALIAS,
 		.alias = alias,
 		.valor = alias_n,
 	});
 }
 
-Expresion* expresion_operacion(EntradaTablaOps* op, Expresion* sub0, 
-	Expresion* sub1) {
-	return expresion_reservar((Expresion){
+void expresion_operacion(Expresion** expresion, EntradaTablaOps* op) {
+	// El subarbol empieza donde empieza su primer operando.
+	int inicio = expresion_sub(*expresion, (*expresion)->n, op->aridad - 1);
+	inicio = expresion_inicio(*expresion, inicio);
+	expresion_agregar(expresion, (Nodo){
 		.tag = X_OPERACION,
-		.op = op,
-		.sub = {sub0, sub1},
+		.op = op->id,
+		.valor = inicio,
 	});
 }
 
-void expresion_limpiar(Expresion* expresion) {
-	if (!expresion)
+void expresion_cadena(Expresion** expresion, EntradaTablaOps* op,
+	int cantidad) {
+	expresion_agregar(expresion, (Nodo){
+		.tag = X_CADENA,
+		.op = op->id,
+		.valor = cantidad,
+	});
+}
+
+Expresion* expresion_copiar(Expresion const* expresion) {
+	Expresion* copia = expresion_crear(expresion->n);
+	memcpy(copia->nodos, expresion->nodos, expresion->n * sizeof(Nodo));
+	copia->n = expresion->n;
+	return copia;
+}
+
+void expresion_ajustar(Expresion** expresion) {
+	Expresion* e = *expresion;
+	if (e->n == e->capacidad || e->n == 0)
 		return;
-	expresion_limpiar(expresion->sub[0]);
-	expresion_limpiar(expresion->sub[1]);
+	e = realloc(e, sizeof(Expresion) + e->n * sizeof(Nodo));
+	assert(e);
+	e->capacidad = e->n;
+	*expresion = e;
+}
+
+void expresion_limpiar(Expresion* expresion) {
 	free(expresion);
 }
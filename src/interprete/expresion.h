@@ -4,6 +4,8 @@
 #include "../funcion_evaluacion.h"
 #include "../tabla_ops.h"
 
+#include <stdint.h>
+
 typedef struct Expresion Expresion;
 
 // este enum, en el contexto de una expresion, nos permite distinguir si la
@@ -12,42 +14,106 @@ typedef enum {
 	X_OPERACION,
 	X_NUMERO,
 	X_ALIAS,
+	X_CADENA, // una operacion asociativa aplicada a mas de dos operandos.
 } ExpressionTag;
 
-struct Expresion {
-	ExpressionTag tag;
-	// para guardar los valores numericos, o la longitud de un alias, 
-	// dependiendo del tag.
-	int valor;
-	// para guardar el texto de un alias.  
+// Un nodo del arbol de expresion. Ocupa 16 bytes (4 nodos por linea de cache).
+// Los nodos de una expresion se guardan contiguos y en orden postfijo, por lo
+// que el ultimo operando de una operacion es siempre el nodo anterior a ella,
+// y cada subarbol ocupa un rango contiguo que termina en su raiz.
+typedef struct Nodo {
+	uint8_t tag; // un ExpressionTag.
+	uint8_t op;  // id del operador en la tabla (de ser una operacion).
+	// para guardar los valores numericos, la longitud de un alias, el indice
+	// del primer nodo del subarbol de una operacion, o la cantidad de operandos
+	// de una cadena, dependiendo del tag.
+	int32_t valor;
+	// para guardar el texto de un alias.
 	char const* alias;
-	// para guardar las sub-expresiones de una operacion.
-	Expresion* sub[2];
-	// para guardar la informacion de la operacion (de haber una).
-	EntradaTablaOps* op; 
+} Nodo;
+
+// Una expresion es el arreglo de nodos de una definicion. La raiz es el ultimo.
+struct Expresion {
+	int n;
+	int capacidad;
+	Nodo nodos[];
 };
 
 /**
- * Devuelve una expresion de numero asociada al valor dado.
+ * Devuelve una expresion sin nodos, con lugar para la cantidad dada.
+ */
+Expresion* expresion_crear(int capacidad);
+
+/**
+ * Agrega el nodo al final de la expresion, tal cual.
+ * La expresion puede ser realocada.
+ */
+void expresion_agregar(Expresion** expresion, Nodo nodo);
+
+/**
+ * Agrega al final de la expresion un nodo de numero asociado al valor dado.
+ * La expresion puede ser realocada.
+ */
+void expresion_numero(Expresion** expresion, int valor);
+
+/**
+ * Agrega al final de la expresion un nodo de alias asociado al alias dado.
+ * La expresion puede ser realocada.
+ */
+void expresion_alias(Expresion** expresion, char const* alias, int alias_n);
+
+/**
+ * Agrega al final de la expresion una operacion, cuyos operandos son los
+ * ultimos 'aridad' subarboles de la expresion. Estos deben existir.
+ * La expresion puede ser realocada.
+ */
+void expresion_operacion(Expresion** expresion, EntradaTablaOps* op);
+
+/**
+ * Agrega al final de la expresion una cadena de la operacion asociativa, cuyos
+ * operandos son los ultimos 'cantidad' subarboles de la expresion, de
+ * izquierda a derecha. Solo se usa en expresiones simplificadas (ver
+ * simplificar.h), que no se recorren por subarboles.
+ * La expresion puede ser realocada.
+ */
+void expresion_cadena(Expresion** expresion, EntradaTablaOps* op,
+	int cantidad);
+
+/**
+ * Devuelve el indice del primer nodo del subarbol con raiz en el nodo 'i'.
+ * No vale para cadenas.
+ */
+static inline int expresion_inicio(Expresion const* expresion, int i) {
+	Nodo const* nodo = &expresion->nodos[i];
+	return nodo->tag == X_OPERACION ? nodo->valor : i;
+}
+
+/**
+ * Devuelve el indice de la raiz del k-esimo operando de la operacion en el
+ * nodo 'i', contando desde el ultimo. Es decir, 'sub(i, 0)' es el operando
+ * derecho y 'sub(i, 1)' el izquierdo.
  */
-Expresion* expresion_numero(int valor);
+static inline int expresion_sub(Expresion const* expresion, int i, int k) {
+	i -= 1;
+	while (k--)
+		i = expresion_inicio(expresion, i) - 1;
+	return i;
+}
 
 /**
- * Devuelve una expresion de alias asociada al alias dado. 
+ * Devuelve una copia de la expresion, con capacidad para sus nodos justos.
  */
-Expresion* expresion_alias(char const* alias, int alias_n);
+Expresion* expresion_copiar(Expresion const* expresion);
 
 /**
- * Devuelve una expresion de operacion asociada a la operacion dada.
+ * Reduce la capacidad de la expresion a su cantidad de nodos.
+ * La expresion puede ser realocada.
  */
-Expresion* expresion_operacion(
-	EntradaTablaOps* op, 
-	Expresion* sub0, 
-	Expresion* sub1);
+void expresion_ajustar(Expresion** expresion);
 
 /**
- * Libera recursivamente el espacio de memoria ocupado por el arbol de
- * expresiones, sin liberar el puntero "alias".  
+ * Libera el espacio de memoria ocupado por la expresion, sin liberar los
+ * punteros "alias".
  */
 void expresion_limpiar(Expresion* expresion);
 
@@ -1,137 +1,187 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "interpretar.h"
 
 #include "expresion.h"
+#include "tabla_alias.h"
 #include "parser.h"
+#include "binario.h"
+#include "diario.h"
+#include "dependencias.h"
+#include "simplificar.h"
 #include "error.h"
+#include "traza.h"
+#include "../paralelo.h"
+#ifdef CONTAR_RESERVAS
+#include "../reservas.h"
+#endif
 
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
 
 #define BUFFER 1024
 
-// Explicacion:
-// para simplificar el uso de memoria, en vez de guardar los aliases, cada uno
-// en su propia region de memoria, referenciamos su posicion original en la
-// linea que ingreso el usuario, mediante un puntero. (char const* alias)
-// Esta linea se guarda en su entrada correspondiente en la tabla de aliases
-// especificamente, el puntero al buffer de entrada va en el campo 'input' de
-// EntradaTablaAlias
-
-// Almacena los datos de un alias definido por el usuario.
-// Tiene una referencia al siguiente alias en la tabla.
-typedef struct EntradaTablaAlias EntradaTablaAlias;
-struct EntradaTablaAlias {
-	EntradaTablaAlias* sig;
-	char* input;
-	char const* alias;
-	int alias_n;
-	Expresion* expresion;
-};
-
-// Almacena la lista de alias definidos por el usuario.
-typedef struct {
-	EntradaTablaAlias* entradas;
-} TablaAlias;
+// Cantidad maxima de bytes que 'imprimir' esta dispuesto a escribir para una
+// sola expresion. Las expresiones mas grandes pueden verse con 'mostrar'.
+#define PRESUPUESTO_IMPRESION ((size_t)1 << 26)
 
-// Busca un alias en la tabla de alias. De no encontrarlo devuelve NULL.
-static EntradaTablaAlias* ta_encontrar(TablaAlias* tabla, char const* alias, 
-	int alias_n) {
-	for (EntradaTablaAlias* it = tabla->entradas; it; it = it->sig)
-		if (it->alias_n == alias_n && memcmp(it->alias, alias, alias_n) == 0)
-			return it;
-	return NULL;
-}
-
-// Inserta un alias nuevo en la tabla de alias.
-static EntradaTablaAlias* ta_insertar(
-	TablaAlias* tabla, 
-	char* input, 
-	char const* alias, 
-	int alias_n, 
-	Expresion* expresion) {
-	EntradaTablaAlias* nuevo = malloc(sizeof(*nuevo));
-	*nuevo = (EntradaTablaAlias) {
-		.sig = tabla->entradas,
-		.alias = alias,
-		.alias_n = alias_n,
-		.input = input,
-		.expresion = expresion
-	};
-	tabla->entradas = nuevo;
-	return nuevo;
-}
+// Cantidad maxima de nodos que 'especializar' esta dispuesto a generar (entre
+// la expresion residual y los residuos de los alias congelados).
+#define LIMITE_RESIDUO (1 << 22)
 
-// Busca el alias en la tabla de alias. En caso de encontrarlo, lo reemplaza y
-// limpia el input y la expresion anteriores.
-// En caso de no existir aun, llama a 'ta_insertar'.
-static EntradaTablaAlias* ta_insertar_o_reemplazar(
-	TablaAlias* tabla, 
-	char* input, 
-	char const* alias, 
-	int alias_n, 
-	Expresion* expresion) {
-	EntradaTablaAlias* encontrado = ta_encontrar(tabla, alias, alias_n);
+// Cantidad minima de nodos de un nivel de 'evaluar todos' para evaluarlo en
+// paralelo: los niveles mas chicos se evaluan en el hilo actual, porque
+// repartirlos cuesta mas que evaluarlos.
+#define NODOS_NIVEL_PARALELO 4096
 
-	// Si no lo encontramos simplemente insertamos.
-	if (encontrado == NULL)
-		return ta_insertar(tabla, input, alias, alias_n, expresion);
-	// Si ya existe, borramos los datos anteriores y lo reemplazamos.
-	free(encontrado->input);
-	encontrado->input = input;
-	encontrado->alias = alias;
+#ifndef CONTAR_RESERVAS
+// Sin el conteo de reservas (ver reservas.h), no hay nada que verificar.
+static inline long long reservas_contadas(void) {
+	return 0;
+}
+#endif
 
-	expresion_limpiar(encontrado->expresion);
-	encontrado->expresion = expresion;
+// Almacena un alias observado por el usuario, junto al ultimo valor que se
+// informo. El nombre se copia, ya que el buffer de la linea se reutiliza.
+typedef struct Observado Observado;
+struct Observado {
+	Observado* sig;
+	char* alias;
+	int alias_n;
+	int valido; // si 'valor' corresponde a una evaluacion exitosa.
+	int valor;
+	int posicion; // en el orden de registro.
+	int nivel; // al notificar un cambio (ver 'nivel_alias').
+};
 
-	return encontrado;
+// Libera el espacio de memoria ocupado por la lista de observados.
+static void observados_limpiar(Observado* observados) {
+	while (observados) {
+		Observado* sig = observados->sig;
+		free(observados->alias);
+		free(observados);
+		observados = sig;
+	}
 }
 
-// Libera el espacio de memoria utilizado por la tabla de alias.
-static void ta_limpiar(TablaAlias* tabla) {
-	EntradaTablaAlias* it = tabla->entradas;
-	while (it) {
-		EntradaTablaAlias* sig = it->sig;
-		expresion_limpiar(it->expresion);
-		free(it->input);
-		free(it);
-		it = sig;
+// Almacena una especializacion: la expresion residual de un alias, y las
+// entradas de los alias congelados en ella (la primera es la del alias
+// especializado). Las entradas se retienen, por lo que no se liberan ni se
+// reutilizan mientras la especializacion exista: comparar punteros alcanza
+// para saber si un alias congelado fue redefinido.
+typedef struct Especializacion Especializacion;
+struct Especializacion {
+	Especializacion* sig;
+	Expresion* residual;
+	EntradaTablaAlias** congeladas;
+	int cantidadCongeladas;
+};
+
+// Descarta la especializacion: la quita de su alias y suelta las entradas
+// congeladas. Devuelve la siguiente de la lista.
+static Especializacion* especializacion_descartar(
+	Especializacion* especializacion) {
+	Especializacion* sig = especializacion->sig;
+	especializacion->congeladas[0]->residual = NULL;
+	for (int i = 0; i < especializacion->cantidadCongeladas; ++i) {
+		especializacion->congeladas[i]->congelada -= 1;
+		ta_soltar(especializacion->congeladas[i]);
 	}
+	expresion_limpiar(especializacion->residual);
+	free(especializacion->congeladas);
+	free(especializacion);
+	return sig;
 }
 
-
 // Estructura que representa el estado de la sesion con el usuario.
-// Guarda una tabla con los alias definidos y el buffer del input.   
-typedef struct {
+// Guarda las opciones, los archivos de entrada y salida de la sesion, la tabla
+// de operadores, una tabla con los alias definidos, los alias observados (en
+// orden de registro; se actualizan por nivel), el indice de los alias que usan
+// cada alias, el buffer del input y la pila de valores que se usa para evaluar
+// expresiones.
+// Si la salida es NULL (al usarse como biblioteca), los errores no se
+// informan.
+struct Entorno {
+	OpcionesInterprete opciones;
+	FILE* entrada;
+	FILE* salida;
+	TablaOps* ops;
 	TablaAlias aliases;
+	// versiones anteriores de la tabla de alias, guardadas con 'instantanea'.
+	TablaAlias* instantaneas;
+	int cantidadInstantaneas;
+	int capacidadInstantaneas;
+	Observado* observados;
+	// los alias que usan cada alias, segun las expresiones originales de la
+	// tabla actual, con los observados asociados a sus nombres. Los alias
+	// cargados de forma perezosa se agregan al armar sus expresiones.
+	Dependencias dependencias;
+	Especializacion* especializaciones;
+	// diario de las definiciones (NULL si no hay), y el lector con el que se
+	// reprodujo, al que apuntan los alias que se cargaron de el.
+	Diario* diario;
+	LectorBinario lectorDiario;
+	int diarioFallo; // si ya se informo un error del diario.
+	int generacion; // numero del ultimo recorrido del grafo de alias.
+	int chequeos;   // numero del ultimo chequeo de alias (ver 'chequear_alias').
 	char* bufferInput;
 	int tamanoBufferInput;
-} Entorno;
+	Expresion* borrador; // donde se arman las expresiones (ver 'parsear').
+	int* pila;
+	int pilaTope;
+	int pilaCapacidad;
+	int alturaMaxima; // mayor altura de evaluacion (ver 'pila_ajustar').
+	// Lo que queda del presupuesto de la sentencia actual: los nodos que se
+	// pueden recorrer hasta el proximo control, los que quedan despues, las
+	// llamadas a operadores y el instante limite (0 si no hay).
+	int nodosHastaControl;
+	long long nodosRestantes;
+	long long operacionesRestantes;
+	uint64_t plazo;
+	int agotado; // si se excedio el presupuesto.
+};
 
 // Devuelve un entorno vacio.
-static Entorno entorno_crear() {
-	return (Entorno){};
-}
-
-// Lee por stdin y almacena en el buffer.
-static void leer_input(Entorno* entorno) {
-	if (entorno->bufferInput == NULL) {
-		entorno->bufferInput = malloc(BUFFER);
-		assert(entorno->bufferInput);
-		entorno->tamanoBufferInput = BUFFER;
-	}
-	char c;
-	size_t size = BUFFER - 1, i = 0;
-	while ((c = getchar()) != '\n') {
-		if (size == i) {
-			entorno->bufferInput = realloc(entorno->bufferInput, size + BUFFER);
+static Entorno entorno_crear(TablaOps* ops, OpcionesInterprete opciones,
+	FILE* entrada, FILE* salida) {
+	return (Entorno){ 
+		.opciones = opciones,
+		.entrada = entrada,
+		.salida = salida,
+		.ops = ops
+	};
+}
+
+// Reserva el buffer de lectura, al comenzar a leer sentencias de texto.
+static void reservar_input(Entorno* entorno) {
+	entorno->bufferInput = malloc(BUFFER);
+	assert(entorno->bufferInput);
+	entorno->tamanoBufferInput = BUFFER;
+}
+
+// Lee una linea de la entrada y la almacena en el buffer. El buffer duplica su
+// tamano cada vez que se llena.
+// Devuelve 0 si la entrada termino sin que se leyera ningun caracter.
+static int leer_input(Entorno* entorno) {
+	int c;
+	size_t i = 0;
+	while ((c = getc(entorno->entrada)) != '\n' && c != EOF) {
+		// Dejamos lugar para el '\0' final.
+		if (i + 1 == (size_t)entorno->tamanoBufferInput) {
+			entorno->tamanoBufferInput *= 2;
+			entorno->bufferInput = 
+				realloc(entorno->bufferInput, entorno->tamanoBufferInput);
 			assert(entorno->bufferInput);
-			size += BUFFER;
 		}
 		entorno->bufferInput[i++] = c;
 	}
 	entorno->bufferInput[i] = '\0';
+	return c != EOF || i > 0;
 }
 
 // Libera el buffer.
@@ -142,99 +192,449 @@ static void descartar_input(Entorno* entorno) {
 	entorno->tamanoBufferInput = 0;
 }
 
-// Se roba el buffer del entorno y lo deja nulo.
-static char* robar_input(Entorno* entorno) {
-	char* buffer = entorno->bufferInput;
-	entorno->bufferInput = NULL;
-	entorno->tamanoBufferInput = 0;
-	return buffer;
+// Prepara una carga leida en formato binario (de la entrada o del diario). Si
+// trae el texto de su expresion en lugar de la expresion (ver B_CARGA_FUENTE),
+// lo copia, porque es del lector, y arma la expresion a partir de la copia
+// (con carga perezosa, recien al usarse). Devuelve la copia, para que la
+// entrada del alias la guarde, o NULL si no hizo falta.
+static char* preparar_carga_binaria(Entorno* entorno, Sentencia* sentencia) {
+	if (sentencia->expresion != NULL)
+		return NULL;
+	char* input = strdup(sentencia->fuente);
+	assert(input);
+	sentencia->fuente = input;
+	if (!entorno->opciones.perezoso) {
+		sentencia->expresion = parsear_expresion(input, entorno->ops);
+		sentencia->fuente = NULL;
+	}
+	return input;
 }
 
-// Libera el espacio de memoria ocupado por el entorno.
+// Copia la linea leida a un buffer de su tamano justo, para que la entrada del
+// alias cargado la guarde, y mueve los punteros de la sentencia a la copia. El
+// buffer de lectura se sigue usando para las proximas lineas.
+// En el formato binario no hay linea (ver 'preparar_carga_binaria').
+static char* copiar_input(Entorno* entorno, Sentencia* sentencia) {
+	char const* buffer = entorno->bufferInput;
+	if (buffer == NULL)
+		return preparar_carga_binaria(entorno, sentencia);
+	size_t largo = strlen(buffer) + 1;
+	char* input = malloc(largo);
+	assert(input);
+	memcpy(input, buffer, largo);
+	sentencia->alias = input + (sentencia->alias - buffer);
+	if (sentencia->fuente)
+		sentencia->fuente = input + (sentencia->fuente - buffer);
+	if (sentencia->expresion) {
+		for (int i = 0; i < sentencia->expresion->n; ++i) {
+			Nodo* nodo = &sentencia->expresion->nodos[i];
+			if (nodo->tag == X_ALIAS)
+				nodo->alias = input + (nodo->alias - buffer);
+		}
+	}
+	return input;
+}
+
+// Libera el espacio de memoria ocupado por el entorno, esperando antes a que
+// se escriba el diario.
 static void entorno_limpiar_datos(Entorno* entorno) {
+	if (entorno->diario != NULL && !diario_cerrar(entorno->diario) &&
+		!entorno->diarioFallo) {
+		fprintf(stderr, "ERROR: no se pudo escribir el diario \'%s\'.\n",
+			entorno->opciones.diario);
+		entorno->diarioFallo = 1;
+	}
+	entorno->diario = NULL;
 	if (entorno->bufferInput != NULL)
 		descartar_input(entorno);
+	while (entorno->especializaciones)
+		entorno->especializaciones =
+			especializacion_descartar(entorno->especializaciones);
+	expresion_limpiar(entorno->borrador);
 	ta_limpiar(&entorno->aliases);
+	for (int i = 0; i < entorno->cantidadInstantaneas; ++i)
+		ta_limpiar(&entorno->instantaneas[i]);
+	free(entorno->instantaneas);
+	observados_limpiar(entorno->observados);
+	dependencias_limpiar(&entorno->dependencias);
+	free(entorno->pila);
+	lector_binario_limpiar(&entorno->lectorDiario);
 	return;
 }
 
 
-// Maneja e imprime en pantalla el error dado.
+// Maneja e imprime en la salida el error dado.
 // En caso de precisarlo, toma valores (y su respectivos largos) para imprimir 
 // el mensaje de error. 
-static void manejar_error(ErrorTag error, const char** val, int* val_n) {
-	printf("ERROR: ");
+static void manejar_error(FILE* salida, ErrorTag error, const char** val,
+	int* val_n) {
+	if (salida == NULL)
+		return;
+	fprintf(salida, "ERROR: ");
 	switch (error) {
 		case E_PARSER_ALIAS: 
-			puts("debe especificarse un alias valido.");
+			fputs("debe especificarse un alias valido.\n", salida);
 			break;
 		case E_PARSER_CARGA: 
-			puts("error en la sintaxis de carga.");
+			fputs("error en la sintaxis de carga.\n", salida);
 			break;
 		case E_PARSER_EXPRESION:
-			puts("expresion invalida.");
+			fputs("expresion invalida.\n", salida);
 			break;
 		case E_PARSER_OPERACION:
-			puts("no se reconocio niguna operacion valida.\n" 
-				"Ingrese \'salir\' para terminar el programa.");
+			fputs("no se reconocio niguna operacion valida.\n" 
+				"Ingrese \'salir\' para terminar el programa.\n", salida);
 			break;
 		case E_PARSER_VACIA:
-			puts("no se permite una expresion vacia.");
+			fputs("no se permite una expresion vacia.\n", salida);
 			break;
 		case E_PARSER_OPERADOR:
-			printf("\'%s\' es un operador y no puede utilizarse como alias.\n", val[0]);
+			fprintf(salida, 
+				"\'%s\' es un operador y no puede utilizarse como alias.\n", val[0]);
+			break;
+		case E_PARSER_NUMERO:
+			fputs("debe especificarse un numero.\n", salida);
+			break;
+		case E_PARSER_VARIANDO:
+			fputs("error en la sintaxis de especializacion.\n", salida);
 			break;
 		case E_INTERPRETE_ALIAS:
-			printf("El alias \'%.*s\' no esta definido.\n", val_n[0], val[0]);
+			fprintf(salida, "El alias \'%.*s\' no esta definido.\n",
+				val_n[0], val[0]);
+			break;
+		case E_INTERPRETE_CICLO:
+			fprintf(salida, "El alias \'%.*s\' depende de si mismo.\n",
+				val_n[0], val[0]);
+			break;
+		case E_INTERPRETE_TAMANO:
+			fprintf(salida,
+				"La expresion de \'%.*s\' es demasiado grande para imprimirse.\n"
+				"Ingrese \'mostrar %.*s\' para verla con sus alias compartidos.\n",
+				val_n[0], val[0], val_n[0], val[0]);
+			break;
+		case E_INTERPRETE_INSTANTANEA:
+			fputs("no existe esa instantanea.\n", salida);
+			break;
+		case E_INTERPRETE_PRESUPUESTO:
+			fprintf(salida,
+				"La evaluacion de \'%.*s\' excedio el presupuesto.\n",
+				val_n[0], val[0]);
+			break;
+		case E_INTERPRETE_RESIDUO:
+			fprintf(salida,
+				"La especializacion de \'%.*s\' es demasiado grande.\n",
+				val_n[0], val[0]);
 			break;
 		default:
-			fflush(stdout); assert(0);
+			fflush(salida); assert(0);
 	}
 }
 
 
-// Chequea que la expresion no tenga alias no definidos. 
-static int chequear_expresion(Expresion* expresion, Entorno* entorno);
+// Devuelve la entrada de la tabla de operadores del nodo de operacion.
+static EntradaTablaOps* operador(Entorno* entorno, Nodo const* nodo) {
+	return &entorno->ops->entradas[nodo->op];
+}
+
+// Arma las expresiones de una entrada cargada de forma perezosa.
+static void materializar(Entorno* entorno, EntradaTablaAlias* entrada) {
+	uint64_t inicio = traza_comienzo();
+	entrada->expresion = parsear_expresion(entrada->fuente, entorno->ops);
+	expresion_ajustar(&entrada->expresion);
+	entrada->simplificada = simplificar(entrada->expresion, entorno->ops);
+	entrada->fuente = NULL;
+	traza_fin("materializar", inicio, entrada->alias, entrada->alias_n,
+		entrada->expresion->n);
+	if (ta_encontrar(&entorno->aliases, entrada->alias, entrada->alias_n) ==
+		entrada)
+		dependencias_definir(&entorno->dependencias, entrada->alias,
+			entrada->alias_n, entrada->expresion);
+}
+
+// Devuelve la expresion original del alias (la que se imprime).
+static Expresion* expresion_original(Entorno* entorno,
+	EntradaTablaAlias* entrada) {
+	if (entrada->expresion == NULL)
+		materializar(entorno, entrada);
+	return entrada->expresion;
+}
+
+// Devuelve la expresion definida para evaluarse: la simplificada, de haberla.
+static Expresion* expresion_definida(Entorno* entorno,
+	EntradaTablaAlias* entrada) {
+	Expresion* original = expresion_original(entorno, entrada);
+	return entrada->simplificada ? entrada->simplificada : original;
+}
+
+// Devuelve la expresion que se evalua: la residual, si el alias esta
+// especializado, o la definida.
+static Expresion* expresion_evaluable(Entorno* entorno,
+	EntradaTablaAlias* entrada) {
+	return entrada->residual ? entrada->residual :
+		expresion_definida(entorno, entrada);
+}
+
+// Renueva el presupuesto, al comenzar una sentencia.
+static void presupuesto_renovar(Entorno* entorno) {
+	Presupuesto presupuesto = entorno->opciones.presupuesto;
+	entorno->nodosHastaControl = 0;
+	entorno->nodosRestantes = presupuesto.nodos ? presupuesto.nodos : LLONG_MAX;
+	entorno->operacionesRestantes =
+		presupuesto.operaciones ? presupuesto.operaciones : LLONG_MAX;
+	entorno->plazo = presupuesto.milisegundos ?
+		traza_reloj() + (uint64_t)presupuesto.milisegundos * 1000000 : 0;
+	entorno->agotado = 0;
+}
+
+// Controla el presupuesto cuando se termina el tramo de nodos habilitado, y
+// habilita el siguiente (contando el nodo actual). Devuelve 0 si se agoto.
+static int presupuesto_controlar(Entorno* entorno) {
+	if (entorno->nodosRestantes == 0 ||
+		(entorno->plazo && traza_reloj() > entorno->plazo)) {
+		entorno->agotado = 1;
+		// Asi, los proximos nodos vuelven a llamar al control.
+		entorno->nodosHastaControl = 0;
+		return 0;
+	}
+	long long tramo = entorno->nodosRestantes < PRESUPUESTO_CONTROL ?
+		entorno->nodosRestantes : PRESUPUESTO_CONTROL;
+	entorno->nodosRestantes -= tramo;
+	entorno->nodosHastaControl = tramo - 1;
+	return 1;
+}
+
+// Descuenta un nodo recorrido del presupuesto. Devuelve 0 si se agoto.
+static inline int presupuesto_nodo(Entorno* entorno) {
+	return entorno->nodosHastaControl-- > 0 || presupuesto_controlar(entorno);
+}
+
+// Chequea que la expresion no tenga alias no definidos, y guarda en 'altura'
+// la cantidad de lugares de la pila que usa su evaluacion.
+static int chequear_expresion(Expresion* expresion, Entorno* entorno,
+	int reportar, int* altura, ErrorTag* error);
 
 // Chequea que el alias exista, y que su expresion asociada no tenga alias no
-// definidos. En caso de no ser valido, el alias no podra evaluarse.
-static int chequear_alias(Entorno* entorno, char const* alias, int alias_n) {
+// definidos ni ciclos. En caso de no ser valido, el alias no podra evaluarse.
+// Si es valido, guarda en 'altura' la cantidad de lugares de la pila que usa
+// su evaluacion, para reservarlos antes de evaluar.
+// Si no es valido, guarda el error en 'error'. Si 'reportar' es 0, no se
+// informa el error al usuario.
+// Cada entrada se recorre a lo sumo una vez por chequeo (ver 'chequeos'), por
+// lo que chequear cuesta tiempo lineal en el tamano del grafo de alias.
+static int chequear_alias(Entorno* entorno, char const* alias, int alias_n,
+	int reportar, int* altura, ErrorTag* error) {
 	// Buscamos el alias.
 	EntradaTablaAlias* entradaAlias = 
 		ta_encontrar(&entorno->aliases, alias, alias_n);
-	if (entradaAlias)
-		return chequear_expresion(entradaAlias->expresion, entorno);
+	if (entradaAlias) {
+		if (entradaAlias->chequeo == entorno->chequeos) {
+			// Ya es valido, o lo estamos chequeando: es un ciclo.
+			if (!entradaAlias->chequeando) {
+				*altura = entradaAlias->altura;
+				return 1;
+			}
+			*error = E_INTERPRETE_CICLO;
+			if (reportar)
+				manejar_error(entorno->salida, E_INTERPRETE_CICLO, &alias, &alias_n);
+			return 0;
+		}
+		entradaAlias->chequeo = entorno->chequeos;
+		entradaAlias->chequeando = 1;
+		int esValido = chequear_expresion(
+			expresion_evaluable(entorno, entradaAlias), entorno, reportar,
+			&entradaAlias->altura, error);
+		entradaAlias->chequeando = 0;
+		*altura = entradaAlias->altura;
+		return esValido;
+	}
 	// No lo encontramos:
 	else {
 		// Manejamos el error correspondiente.
-		manejar_error(E_INTERPRETE_ALIAS, &alias, &alias_n);
+		*error = E_INTERPRETE_ALIAS;
+		if (reportar)
+			manejar_error(entorno->salida, E_INTERPRETE_ALIAS, &alias, &alias_n);
 		return 0;
 	}
 }
 
 // 'chequear_expresion' y 'chequear_alias' son mutuamente dependientes.
-static int chequear_expresion(Expresion* expresion, Entorno* entorno) {
-	int esValida;
-	switch (expresion->tag) {
-	case X_OPERACION:
-		// Si la operacion es unaria solo chequeamos un argumento.
-		if (expresion->op->aridad == 1)
-			esValida = chequear_expresion(expresion->sub[0], entorno);
-		else
-			esValida = chequear_expresion(expresion->sub[1], entorno) &&
-				chequear_expresion(expresion->sub[0], entorno);
-		break;
-	case X_NUMERO:
-		esValida =  1;
-    break;
-	case X_ALIAS:
-		// Llamamos a 'chequear_alias'
-		esValida = chequear_alias(entorno, expresion->alias, expresion->valor);
-		break;
+// Como los nodos estan en orden postfijo, los alias se chequean de izquierda a
+// derecha. La altura se calcula siguiendo la cantidad de valores apilados: un
+// alias usa, por encima de ellos, la altura de su propia evaluacion.
+static int chequear_expresion(Expresion* expresion, Entorno* entorno,
+	int reportar, int* altura, ErrorTag* error) {
+	int apilados = 0;
+	int maximo = 0;
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (!presupuesto_nodo(entorno)) {
+			*error = E_INTERPRETE_PRESUPUESTO;
+			return 0;
+		}
+		switch (nodo->tag) {
+		case X_OPERACION:
+			apilados -= operador(entorno, nodo)->aridad - 1;
+			break;
+		case X_CADENA:
+			apilados -= nodo->valor - 1;
+			break;
+		case X_NUMERO:
+			if (++apilados > maximo)
+				maximo = apilados;
+			break;
+		case X_ALIAS: {
+			int sub;
+			if (!chequear_alias(entorno, nodo->alias, nodo->valor, reportar, &sub,
+				error))
+				return 0;
+			if (apilados + sub > maximo)
+				maximo = apilados + sub;
+			apilados += 1;
+		} break;
+		}
+	}
+	*altura = maximo;
+	return 1;
+}
+
+
+// Se asegura de que la pila de evaluacion tenga lugar para 'n' valores mas.
+// La pila crece al cambiar los alias (ver 'pila_ajustar'), por lo que al
+// evaluar solo crece si se usa una carga perezosa (ver 'chequear_alias').
+static void pila_reservar(Entorno* entorno, int n) {
+	if (entorno->pilaTope + n <= entorno->pilaCapacidad)
+		return;
+	int capacidad = entorno->pilaCapacidad ? entorno->pilaCapacidad : BUFFER;
+	while (capacidad < entorno->pilaTope + n)
+		capacidad *= 2;
+	entorno->pila = realloc(entorno->pila, capacidad * sizeof(int));
+	assert(entorno->pila);
+	entorno->pilaCapacidad = capacidad;
+}
+
+// Devuelve los lugares de la pila que usa la evaluacion del alias de la
+// entrada, calculados igual que en 'chequear_alias' pero sin chequearlo (los
+// alias no definidos y los ciclos no suman lugares, porque no se evaluan).
+// La altura queda guardada en la entrada hasta que se invalide (ver
+// 'pila_ajustar'), por lo que solo se recorren las entradas invalidadas; el
+// resto del recorrido debe ser de una generacion nueva.
+static int altura_evaluacion(Entorno* entorno, EntradaTablaAlias* entrada) {
+	if (entrada == NULL)
+		return 0;
+	if (entrada->alturaVigente)
+		return entrada->alturaEvaluacion;
+	// Una entrada marcada y sin altura esta en curso: es un ciclo.
+	if (entrada->marca == entorno->generacion)
+		return 0;
+	entrada->marca = entorno->generacion;
+	Expresion* expresion = expresion_evaluable(entorno, entrada);
+	int apilados = 0;
+	int maximo = 0;
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		switch (nodo->tag) {
+		case X_OPERACION:
+			apilados -= operador(entorno, nodo)->aridad - 1;
+			break;
+		case X_CADENA:
+			apilados -= nodo->valor - 1;
+			break;
+		case X_NUMERO:
+			if (++apilados > maximo)
+				maximo = apilados;
+			break;
+		case X_ALIAS: {
+			int sub = altura_evaluacion(entorno,
+				ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor));
+			if (apilados + sub > maximo)
+				maximo = apilados + sub;
+			apilados += 1;
+		} break;
+		}
 	}
-	return esValida;
+	entrada->alturaEvaluacion = maximo;
+	entrada->alturaVigente = 1;
+	return maximo;
 }
 
+// Ajusta la pila al cambiar las entradas dadas de la tabla actual (y las que
+// dependen de ellas), para que las evaluaciones siguientes no tengan que
+// reservar memoria: vuelve a calcular sus alturas y, si alguna supera la
+// mayor altura conocida, hace crecer la pila hasta ella. La pila no se achica.
+// Con carga perezosa no hace nada, porque calcular las alturas armaria las
+// expresiones: las evaluaciones hacen crecer la pila (ver 'chequear_alias').
+static void pila_ajustar(Entorno* entorno, EntradaTablaAlias** entradas,
+	int cantidad) {
+	if (entorno->opciones.perezoso)
+		return;
+	for (int i = 0; i < cantidad; ++i)
+		entradas[i]->alturaVigente = 0;
+	entorno->generacion += 1;
+	for (int i = 0; i < cantidad; ++i) {
+		int altura = altura_evaluacion(entorno, entradas[i]);
+		if (altura > entorno->alturaMaxima)
+			entorno->alturaMaxima = altura;
+	}
+	pila_reservar(entorno, entorno->alturaMaxima);
+}
+
+// Entradas de la tabla actual visitadas en un recorrido del indice de
+// dependencias.
+typedef struct {
+	Entorno* entorno;
+	EntradaTablaAlias** entradas;
+	int cantidad;
+	int capacidad;
+} Visitadas;
+
+// Agrega a las visitadas la entrada del alias visitado, si esta definido.
+static void visitadas_agregar(void* visitadas_, char const* alias, int alias_n,
+	void* observado) {
+	(void)observado;
+	Visitadas* visitadas = visitadas_;
+	EntradaTablaAlias* entrada =
+		ta_encontrar(&visitadas->entorno->aliases, alias, alias_n);
+	if (entrada == NULL)
+		return;
+	if (visitadas->cantidad == visitadas->capacidad) {
+		visitadas->capacidad = visitadas->capacidad ? 2 * visitadas->capacidad : 8;
+		visitadas->entradas = realloc(visitadas->entradas,
+			visitadas->capacidad * sizeof(*visitadas->entradas));
+		assert(visitadas->entradas);
+	}
+	visitadas->entradas[visitadas->cantidad++] = entrada;
+}
+
+// Ajusta la pila al cambiar el alias (al cargarlo, borrarlo o especializarlo):
+// solo cambian las alturas de los alias que dependen de el, que se hallan
+// recorriendo el indice de dependencias.
+static void pila_ajustar_alias(Entorno* entorno, char const* alias,
+	int alias_n) {
+	if (entorno->opciones.perezoso)
+		return;
+	Visitadas visitadas = { .entorno = entorno };
+	dependencias_recorrer(&entorno->dependencias, alias, alias_n,
+		visitadas_agregar, &visitadas);
+	pila_ajustar(entorno, visitadas.entradas, visitadas.cantidad);
+	free(visitadas.entradas);
+}
+
+// Reserva de antemano los buffers que se reutilizan entre sentencias (el
+// borrador del parser y la pila; el de lectura, al leer texto), para que las
+// sentencias que no modifican el entorno no tengan que reservar memoria.
+static void entorno_preparar(Entorno* entorno) {
+	entorno->borrador = expresion_crear(16);
+	pila_reservar(entorno, BUFFER);
+}
+
+// Devuelve 1 si la sentencia no modifica el entorno, por lo que le alcanza con
+// los buffers ya reservados, mientras no tengan que crecer (el programa
+// 'interprete_reservas' verifica que no reserve memoria). Con carga perezosa,
+// usar un alias por primera vez arma sus expresiones, por lo que no cuenta.
+static inline int solo_lectura(Entorno* entorno, SentenciaTag tag) {
+	return !entorno->opciones.perezoso && (tag == S_EVALUAR ||
+		tag == S_IMPRIMIR || tag == S_SALIR || tag == S_INVALIDO);
+}
 
 // Evalua un arbol de expresion.
 static int evaluar_arbol(Expresion* expresion, Entorno* entorno);
@@ -244,149 +644,1614 @@ static int evaluar_alias(Entorno* entorno, char const* alias, int alias_n) {
 	// Buscamos el alias.
 	EntradaTablaAlias* entradaAlias = 
 		ta_encontrar(&entorno->aliases, alias, alias_n);
-	Expresion* expresion = entradaAlias->expresion;
-	// Evaluamos la expresion asociada.
+	Expresion* expresion = expresion_evaluable(entorno, entradaAlias);
+	// Evaluamos la expresion asociada (simplificada, de tenerla).
 	return evaluar_arbol(expresion, entorno);
 }
 
-// 'evaluar_arbol' y 'evaluar_alias' son mutuamente dependientes.								
+// 'evaluar_arbol' y 'evaluar_alias' son mutuamente dependientes.
+// Recorre los nodos en orden postfijo usando la pila de valores del entorno:
+// cada operacion toma sus operandos del tope de la pila y apila su resultado.
+// Las evaluaciones de otros alias apilan sus valores por encima, y al terminar
+// dejan la pila como la encontraron.
+// La pila ya debe tener lugar para la evaluacion (ver 'chequear_alias').
+// Si se agota el presupuesto, devuelve 0 sin restaurar la pila (ver
+// 'evaluar_acotado').
 static int evaluar_arbol(Expresion* expresion, Entorno* entorno) {
-	// Si no hay expresion, devolvemos 0. Este valor NO DEBE SER UTILIZADO.
-	if (!expresion) return 0;
-  switch (expresion->tag) {
-	case X_OPERACION: {
-		// Evaluamos los subarboles recursivamente y los usamos como argumentos.
-		int args[2] =
-			{evaluar_arbol(expresion->sub[0], entorno),
-			evaluar_arbol(expresion->sub[1], entorno)};
-		return expresion->op->eval(args);
-	} break;
-	case X_NUMERO:
-		return expresion->valor;
-		break;
-	case X_ALIAS:
-		// Llamamos a 'evaluar_alias'.
-		return evaluar_alias(entorno, expresion->alias, expresion->valor);
-		break;
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (!presupuesto_nodo(entorno))
+			return 0;
+		switch (nodo->tag) {
+		case X_OPERACION: {
+			if (entorno->operacionesRestantes-- == 0) {
+				entorno->agotado = 1;
+				return 0;
+			}
+			// Los argumentos van del ultimo operando al primero.
+			int* tope = &entorno->pila[entorno->pilaTope];
+			EntradaTablaOps* op = operador(entorno, nodo);
+			int args[2] = {tope[-1], op->aridad == 2 ? tope[-2] : 0};
+			entorno->pilaTope -= op->aridad;
+			entorno->pila[entorno->pilaTope++] = op->eval(args);
+		} break;
+		case X_CADENA: {
+			// Los operandos de la cadena quedaron contiguos en la pila, en orden:
+			// los reducimos de una vez (cuenta como una operacion por operando
+			// de mas).
+			if (entorno->operacionesRestantes < nodo->valor - 1) {
+				entorno->agotado = 1;
+				return 0;
+			}
+			entorno->operacionesRestantes -= nodo->valor - 1;
+			entorno->pilaTope -= nodo->valor;
+			int* valores = &entorno->pila[entorno->pilaTope];
+			entorno->pila[entorno->pilaTope++] =
+				tabla_ops_reducir(operador(entorno, nodo), valores, nodo->valor);
+		} break;
+		case X_NUMERO:
+			entorno->pila[entorno->pilaTope++] = nodo->valor;
+			break;
+		case X_ALIAS: {
+			// Llamamos a 'evaluar_alias'.
+			int valor = evaluar_alias(entorno, nodo->alias, nodo->valor);
+			if (entorno->agotado)
+				return 0;
+			entorno->pila[entorno->pilaTope++] = valor;
+		} break;
+		}
 	}
-	// No deberiamos llegar hasta aca.
-	assert(0);
+	return entorno->pila[--entorno->pilaTope];
 } 
 
-// Imprime una expresion en pantalla de forma infija.
+// Devuelve la cantidad de nodos de la expresion asociada al alias, o -1 si
+// no esta definido. Se usa para informar el tamano de las fases en la traza.
+static int nodos_alias(Entorno* entorno, char const* alias, int alias_n) {
+	EntradaTablaAlias* entradaAlias = 
+		ta_encontrar(&entorno->aliases, alias, alias_n);
+	return entradaAlias && entradaAlias->expresion ? 
+		entradaAlias->expresion->n : -1;
+}
+
+// Chequea el alias y, si es valido, lo evalua y guarda su valor en 'valor',
+// con lo que queda del presupuesto de la sentencia. Si el presupuesto se agota,
+// deja la pila como estaba. Si 'reportar' es distinto de 0, informa los
+// errores. Devuelve 0 si el alias no pudo evaluarse, y guarda el error en
+// 'error' (si no es NULL).
+static int evaluar_acotado(Entorno* entorno, char const* alias, int alias_n,
+	int reportar, int* valor, ErrorTag* error) {
+	int nodos = trazaActiva ? nodos_alias(entorno, alias, alias_n) : -1;
+	int tope = entorno->pilaTope;
+	uint64_t inicio = traza_comienzo();
+	entorno->chequeos += 1;
+	int altura;
+	ErrorTag propio;
+	if (error == NULL)
+		error = &propio;
+	int esValido = !entorno->agotado &&
+		chequear_alias(entorno, alias, alias_n, reportar, &altura, error);
+	traza_fin("chequear_alias", inicio, alias, alias_n, nodos);
+	if (esValido) {
+		pila_reservar(entorno, altura);
+		inicio = traza_comienzo();
+		*valor = evaluar_alias(entorno, alias, alias_n);
+		traza_fin("evaluar_arbol", inicio, alias, alias_n, nodos);
+	}
+	if (!entorno->agotado)
+		return esValido;
+	entorno->pilaTope = tope;
+	*error = E_INTERPRETE_PRESUPUESTO;
+	if (reportar)
+		manejar_error(entorno->salida, E_INTERPRETE_PRESUPUESTO, &alias, &alias_n);
+	return 0;
+}
+
+// Devuelve la cantidad de caracteres que ocupa el numero al imprimirse.
+static size_t largo_numero(int valor) {
+	size_t largo = valor < 0 ? 2 : 1;
+	while (valor /= 10)
+		largo += 1;
+	return largo;
+}
+
+// Suma dos tamanos, saturando en SIZE_MAX.
+static size_t sumar_tamanos(size_t a, size_t b) {
+	return a > SIZE_MAX - b ? SIZE_MAX : a + b;
+}
+
+// Calcula una cota del largo de la expansion del alias al imprimirlo.
+// Cada alias se recorre una sola vez por generacion, por lo que el calculo es
+// lineal en el tamano del grafo de alias, aunque la expansion sea exponencial.
+// Devuelve 0 si encuentra un ciclo, y guarda en 'ciclo' el alias que lo cierra.
+static int tamano_alias(Entorno* entorno, EntradaTablaAlias* entrada,
+	EntradaTablaAlias** ciclo) {
+	if (entrada->marca == entorno->generacion) {
+		if (entrada->enCurso) {
+			*ciclo = entrada;
+			return 0;
+		}
+		return 1;
+	}
+	entrada->marca = entorno->generacion;
+	entrada->enCurso = 1;
+	size_t tamano = 0;
+	Expresion* expresion = expresion_original(entorno, entrada);
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		switch (nodo->tag) {
+		case X_OPERACION: {
+			// El simbolo, los espacios que lo rodean y un posible parentesis.
+			EntradaTablaOps* op = operador(entorno, nodo);
+			tamano = sumar_tamanos(tamano, strlen(op->simbolo) + 4);
+		} break;
+		case X_NUMERO:
+			tamano = sumar_tamanos(tamano, largo_numero(nodo->valor));
+			break;
+		case X_ALIAS: {
+			EntradaTablaAlias* sub = 
+				ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor);
+			// Un alias no definido se imprime por nombre, con un espacio.
+			if (sub == NULL)
+				tamano = sumar_tamanos(tamano, nodo->valor + 1);
+			else if (tamano_alias(entorno, sub, ciclo))
+				tamano = sumar_tamanos(tamano, sub->tamano);
+			else
+				return 0;
+		} break;
+		}
+	}
+	entrada->tamano = tamano;
+	entrada->enCurso = 0;
+	return 1;
+}
+
+// Imprime el subarbol con raiz en el nodo 'i' en pantalla de forma infija.
 // En caso de la expresion contener un alias no definido, imprime el nombre del 
-// alias.
+// alias. Si 'compartidos' es distinto de 0, tampoco se expanden los alias
+// usados mas de una vez (segun el campo 'usos' de su entrada).
 // LLamamos a la funcion con: 
 // la precedencia de la expresion padre, para determinar si necesitamos usar 
 // parentesis;
 // un valor que determine si nos encontramos a la izquierda de la operacion. 
-static void imprimir_expresion(Expresion* expresion, int precedencia, 
-	int izquierda, Entorno* entorno) {
-	switch (expresion->tag) {
+static void imprimir_expresion(Expresion* expresion, int i, int precedencia, 
+	int izquierda, int compartidos, Entorno* entorno) {
+	Nodo const* nodo = &expresion->nodos[i];
+	switch (nodo->tag) {
 	case X_OPERACION: {
-		int precedenciaOp = expresion->op->precedencia;
+		EntradaTablaOps* op = operador(entorno, nodo);
+		int precedenciaOp = op->precedencia;
 		// Manejamos operaciones unarias.
-		if (expresion->op->aridad == 1) {
+		if (op->aridad == 1) {
 			// Si no estamos a la izquierda de un termino usamos parentesis.
-			if (!izquierda) printf("(");
-			printf("%s", expresion->op->simbolo);
-			imprimir_expresion(expresion->sub[0], precedenciaOp, 0, entorno);
-			if (!izquierda) printf(")");
+			if (!izquierda) fprintf(entorno->salida, "(");
+			fprintf(entorno->salida, "%s", op->simbolo);
+			imprimir_expresion(expresion, expresion_sub(expresion, i, 0),
+				precedenciaOp, 0, compartidos, entorno);
+			if (!izquierda) fprintf(entorno->salida, ")");
 		}
 		else {
 			// Si tenemos menor precedencia usamos parentesis.
 			if (precedenciaOp < precedencia) {
-				printf("(");
+				fprintf(entorno->salida, "(");
 				// Comenzamos un termino nuevo, por lo tanto estamos a la izquierda.
 				izquierda = 1;
 			}
-			imprimir_expresion(expresion->sub[1], precedenciaOp, izquierda, entorno);
-			printf(" %s ", expresion->op->simbolo);
-			imprimir_expresion(expresion->sub[0], precedenciaOp, 0, entorno);
-			if (expresion->op->precedencia < precedencia) printf(")");
+			imprimir_expresion(expresion, expresion_sub(expresion, i, 1),
+				precedenciaOp, izquierda, compartidos, entorno);
+			fprintf(entorno->salida, " %s ", op->simbolo);
+			imprimir_expresion(expresion, expresion_sub(expresion, i, 0),
+				precedenciaOp, 0, compartidos, entorno);
+			if (precedenciaOp < precedencia) fprintf(entorno->salida, ")");
 		}
 	}	break;
 	case X_NUMERO:
 		// Imprimimos el numero.
-		printf("%d", expresion->valor);
+		fprintf(entorno->salida, "%d", nodo->valor);
 		break;
 	case X_ALIAS: {
 		EntradaTablaAlias* entradaAlias = 
-			ta_encontrar(&entorno->aliases, expresion->alias, expresion->valor);
-		if (entradaAlias) {
-			expresion = entradaAlias->expresion;
+			ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor);
+		// Si es compartido, imprimimos su nombre: se muestra en su propia linea.
+		if (entradaAlias && compartidos && entradaAlias->usos > 1)
+			fprintf(entorno->salida, "%.*s", nodo->valor, nodo->alias);
+		else if (entradaAlias) {
+			Expresion* asociada = expresion_original(entorno, entradaAlias);
 			// imprimo la expresion asociada al alias
-			imprimir_expresion(expresion, precedencia, izquierda, entorno);		
+			imprimir_expresion(asociada, asociada->n - 1, precedencia, izquierda,
+				compartidos, entorno);		
 		}
 		// Si no lo reconocemos, imprimimos el nombre del alias.
 		else {
-			if (!izquierda) printf(" ");
-			printf("%.*s", expresion->valor, expresion->alias);
+			if (!izquierda) fprintf(entorno->salida, " ");
+			fprintf(entorno->salida, "%.*s", nodo->valor, nodo->alias);
 		}
 	}	break;
 	}
 }
 
+// Imprime la expresion completa, tomando como precedencia inicial la de su
+// raiz.
+static void imprimir_raiz(Entorno* entorno, Expresion* expresion,
+	int compartidos) {
+	Nodo const* raiz = &expresion->nodos[expresion->n - 1];
+	int precedencia = 0;
+	if (raiz->tag == X_OPERACION)
+		precedencia = operador(entorno, raiz)->precedencia;
+	imprimir_expresion(expresion, expresion->n - 1, precedencia, 1, compartidos,
+		entorno);		
+}
+
+// Busca la entrada del alias y chequea que se pueda imprimir: que este
+// definido, que no tenga ciclos, y que el largo estimado de su expansion no
+// supere PRESUPUESTO_IMPRESION. Si no se puede, informa el error (de tener
+// salida), lo guarda en 'error' y devuelve NULL.
+static EntradaTablaAlias* preparar_impresion(Entorno* entorno,
+	char const* alias, int alias_n, ErrorTag* error) {
+	EntradaTablaAlias* entradaAlias = 
+		ta_encontrar(&entorno->aliases, alias, alias_n);
+	// Si el alias no esta definido, elevamos error.
+	if (entradaAlias == NULL) {
+		manejar_error(entorno->salida, E_INTERPRETE_ALIAS, &alias, &alias_n);
+		*error = E_INTERPRETE_ALIAS;
+		return NULL;
+	}
+	EntradaTablaAlias* ciclo = NULL;
+	entorno->generacion += 1;
+	if (!tamano_alias(entorno, entradaAlias, &ciclo)) {
+		manejar_error(entorno->salida, E_INTERPRETE_CICLO, &ciclo->alias, &ciclo->alias_n);
+		*error = E_INTERPRETE_CICLO;
+		return NULL;
+	}
+	if (entradaAlias->tamano > PRESUPUESTO_IMPRESION) {
+		manejar_error(entorno->salida, E_INTERPRETE_TAMANO, &alias, &alias_n);
+		*error = E_INTERPRETE_TAMANO;
+		return NULL;
+	}
+	return entradaAlias;
+}
+
 // Imprime en pantalla la expresion asociada al alias.
 // Busca la expresion asociada y llama a 'imprimir_expresion'.
-// En caso de que esta no exista, imprime el nombre del alias.
+// Antes de imprimir, se estima el largo de la expansion: si hay un ciclo, o si
+// supera PRESUPUESTO_IMPRESION, se informa el error sin escribir nada.
 static void imprimir(Entorno* entorno, char const* alias, int alias_n) {
+	ErrorTag error;
 	EntradaTablaAlias* entradaAlias = 
-		ta_encontrar(&entorno->aliases, alias, alias_n);
+		preparar_impresion(entorno, alias, alias_n, &error);
 	if (entradaAlias) {
-		Expresion* expresion = entradaAlias->expresion; 
-		int precedencia = 0;
-		if (expresion->tag == X_OPERACION) precedencia = expresion->op->precedencia;
-		imprimir_expresion(expresion, precedencia, 1, entorno);		
-		puts("");
+		imprimir_raiz(entorno, expresion_original(entorno, entradaAlias), 0);
+		fputc('\n', entorno->salida);
+	}
+}
+
+// Cuenta cuantas veces se referencia cada alias alcanzable desde la entrada,
+// contando una sola vez la expresion de cada alias. Cada alias se recorre una
+// sola vez por generacion.
+// Devuelve 0 si encuentra un ciclo, y guarda en 'ciclo' el alias que lo cierra.
+static int contar_usos(Entorno* entorno, EntradaTablaAlias* entrada,
+	EntradaTablaAlias** ciclo) {
+	entrada->marca = entorno->generacion;
+	entrada->enCurso = 1;
+	entrada->usos = 0;
+	Expresion* expresion = expresion_original(entorno, entrada);
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (nodo->tag != X_ALIAS)
+			continue;
+		EntradaTablaAlias* sub = 
+			ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor);
+		if (sub == NULL)
+			continue;
+		if (sub->marca != entorno->generacion) {
+			if (!contar_usos(entorno, sub, ciclo))
+				return 0;
+		}
+		else if (sub->enCurso) {
+			*ciclo = sub;
+			return 0;
+		}
+		sub->usos += 1;
 	}
+	entrada->enCurso = 0;
+	return 1;
+}
+
+// Imprime, antes que la entrada, a los alias compartidos de los que depende.
+// Luego, si la entrada es compartida (o es la raiz), la imprime como
+// "ALIAS = EXPRESION", sin expandir los alias compartidos.
+static void mostrar_entrada(Entorno* entorno, EntradaTablaAlias* entrada) {
+	entrada->marca = entorno->generacion;
+	Expresion* expresion = expresion_original(entorno, entrada);
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (nodo->tag != X_ALIAS)
+			continue;
+		EntradaTablaAlias* sub = 
+			ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor);
+		if (sub && sub->marca != entorno->generacion)
+			mostrar_entrada(entorno, sub);
+	}
+	if (entrada->usos != 1) {
+		fprintf(entorno->salida, "%.*s = ", entrada->alias_n, entrada->alias);
+		imprimir_raiz(entorno, expresion, 1);
+		fputc('\n', entorno->salida);
+	}
+}
+
+// Imprime la expresion asociada al alias sin expandir mas de una vez a los
+// alias compartidos: cada alias referenciado mas de una vez se imprime una sola
+// vez, en su propia linea, antes de los alias que lo usan. De esta forma, el
+// largo de la salida es lineal en el tamano del grafo de alias.
+static void mostrar(Entorno* entorno, char const* alias, int alias_n) {
+	EntradaTablaAlias* entradaAlias = 
+		ta_encontrar(&entorno->aliases, alias, alias_n);
 	// Si el alias no esta definido, elevamos error.
-	else manejar_error(E_INTERPRETE_ALIAS, &alias, &alias_n);
+	if (entradaAlias == NULL) {
+		manejar_error(entorno->salida, E_INTERPRETE_ALIAS, &alias, &alias_n);
+		return;
+	}
+	EntradaTablaAlias* ciclo = NULL;
+	entorno->generacion += 1;
+	if (!contar_usos(entorno, entradaAlias, &ciclo)) {
+		manejar_error(entorno->salida, E_INTERPRETE_CICLO, &ciclo->alias, &ciclo->alias_n);
+		return;
+	}
+	entorno->generacion += 1;
+	mostrar_entrada(entorno, entradaAlias);
+}
+
+// Vuelve a evaluar el alias observado. Si su valor cambio respecto al ultimo
+// informado, lo imprime en pantalla. Los errores no se informan: un observado
+// que no puede evaluarse simplemente queda a la espera de nuevos cambios.
+static void actualizar_observado(Entorno* entorno, Observado* observado) {
+	int valor;
+	if (!evaluar_acotado(entorno, observado->alias, observado->alias_n, 0,
+		&valor, NULL)) {
+		observado->valido = 0;
+		return;
+	}
+	if (observado->valido && observado->valor == valor)
+		return;
+	observado->valido = 1;
+	observado->valor = valor;
+	fprintf(entorno->salida, "%.*s = %d\n", observado->alias_n, observado->alias,
+		valor);
+}
+
+// Registra el alias como observado e informa su valor actual (de tenerlo).
+// Observar dos veces el mismo alias no tiene efecto.
+static void observar(Entorno* entorno, char const* alias, int alias_n) {
+	Observado** it = &entorno->observados;
+	int posicion = 0;
+	for (; *it; it = &(*it)->sig, ++posicion)
+		if ((*it)->alias_n == alias_n && memcmp((*it)->alias, alias, alias_n) == 0)
+			return;
+	Observado* nuevo = malloc(sizeof(*nuevo));
+	*nuevo = (Observado){
+		.alias = malloc(alias_n),
+		.alias_n = alias_n,
+		.posicion = posicion,
+	};
+	memcpy(nuevo->alias, alias, alias_n);
+	// Lo agregamos al final, para respetar el orden de registro.
+	*it = nuevo;
+	dependencias_asociar(&entorno->dependencias, nuevo->alias, nuevo->alias_n,
+		nuevo);
+	actualizar_observado(entorno, nuevo);
 }
 
-// Carga el alias en la tabla de alias. Si ya esta definido, lo reemplaza.
+// Calcula el nivel de dependencia del alias, igual que en 'evaluar todos': 0
+// si no usa otros alias, y si no, uno mas que el maximo nivel de los alias que
+// usa (los no definidos y los ciclos cuentan como nivel 0). Cada entrada se
+// recorre a lo sumo una vez por generacion, y guarda su nivel en 'indice'.
+static int nivel_alias(Entorno* entorno, char const* alias, int alias_n) {
+	EntradaTablaAlias* entradaAlias =
+		ta_encontrar(&entorno->aliases, alias, alias_n);
+	if (entradaAlias == NULL)
+		return 0;
+	if (entradaAlias->marca == entorno->generacion)
+		return entradaAlias->enCurso ? 0 : entradaAlias->indice;
+	entradaAlias->marca = entorno->generacion;
+	entradaAlias->enCurso = 1;
+	int nivel = 0;
+	Expresion* expresion = expresion_evaluable(entorno, entradaAlias);
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (nodo->tag != X_ALIAS)
+			continue;
+		int sub = nivel_alias(entorno, nodo->alias, nodo->valor) + 1;
+		if (sub > nivel)
+			nivel = sub;
+	}
+	entradaAlias->enCurso = 0;
+	entradaAlias->indice = nivel;
+	return nivel;
+}
+
+// Compara dos observados por nivel y luego por orden de registro, para
+// 'qsort'.
+static int comparar_nivel(void const* a_, void const* b_) {
+	Observado const* a = *(Observado* const*)a_;
+	Observado const* b = *(Observado* const*)b_;
+	if (a->nivel != b->nivel)
+		return a->nivel < b->nivel ? -1 : 1;
+	return a->posicion - b->posicion;
+}
+
+// Lista de observados afectados por un cambio.
+typedef struct {
+	Observado** observados;
+	int cantidad;
+	int capacidad;
+} Afectados;
+
+// Agrega a los afectados el observado asociado al alias visitado, de haberlo.
+static void afectados_agregar(void* afectados_, char const* alias, int alias_n,
+	void* observado) {
+	(void)alias;
+	(void)alias_n;
+	Afectados* afectados = afectados_;
+	if (observado == NULL)
+		return;
+	if (afectados->cantidad == afectados->capacidad) {
+		afectados->capacidad = afectados->capacidad ? 2 * afectados->capacidad : 8;
+		afectados->observados = realloc(afectados->observados,
+			afectados->capacidad * sizeof(*afectados->observados));
+		assert(afectados->observados);
+	}
+	afectados->observados[afectados->cantidad++] = observado;
+}
+
+// Vuelve a evaluar los observados afectados por la redefinicion del alias, de
+// a un nivel de dependencia por vez (como 'evaluar todos'): un observado se
+// informa despues de los observados de los que depende. Los afectados se
+// hallan recorriendo el indice de dependencias desde el alias, por lo que
+// solo se visitan los alias que lo usan, y solo se ordenan esos observados.
+// Si el alias es NULL, todos los observados estan afectados.
+static void notificar_observados(Entorno* entorno, char const* alias,
+	int alias_n) {
+	if (entorno->observados == NULL)
+		return;
+	Afectados afectados = {0};
+	if (alias != NULL)
+		dependencias_recorrer(&entorno->dependencias, alias, alias_n,
+			afectados_agregar, &afectados);
+	else
+		for (Observado* it = entorno->observados; it; it = it->sig)
+			afectados_agregar(&afectados, it->alias, it->alias_n, it);
+	// Los ordenamos por nivel, en un recorrido nuevo del grafo de alias.
+	if (afectados.cantidad > 1) {
+		entorno->generacion += 1;
+		for (int i = 0; i < afectados.cantidad; ++i) {
+			Observado* observado = afectados.observados[i];
+			observado->nivel = nivel_alias(entorno, observado->alias,
+				observado->alias_n);
+		}
+		qsort(afectados.observados, afectados.cantidad,
+			sizeof(*afectados.observados), comparar_nivel);
+	}
+	for (int i = 0; i < afectados.cantidad; ++i)
+		actualizar_observado(entorno, afectados.observados[i]);
+	free(afectados.observados);
+}
+
+// Descarta las especializaciones en las que la entrada esta congelada, porque
+// su alias se va a redefinir o a borrar. Debe hacerse antes de notificar a los
+// observados, para que se evaluen sin los residuos viejos.
+static void descongelar(Entorno* entorno, EntradaTablaAlias* entrada) {
+	if (entrada == NULL || entrada->congelada == 0)
+		return;
+	Especializacion** it = &entorno->especializaciones;
+	while (*it) {
+		int congelada = 0;
+		for (int i = 0; i < (*it)->cantidadCongeladas && !congelada; ++i)
+			congelada = (*it)->congeladas[i] == entrada;
+		if (congelada)
+			*it = especializacion_descartar(*it);
+		else
+			it = &(*it)->sig;
+	}
+}
+
+// Carga el alias en la tabla de alias, junto a su expresion simplificada. Si ya
+// esta definido, lo reemplaza (descartando las especializaciones que lo
+// congelaron). Luego, informa los cambios en los alias observados.
+// Si la carga es perezosa, la expresion es NULL y las expresiones se arman
+// recien cuando se usa el alias, a partir de 'fuente'.
 static void cargar(Entorno* entorno, char* input, char const* alias, int alias_n, 
-	Expresion* expresion) {
-	ta_insertar_o_reemplazar(&entorno->aliases, input, alias, alias_n, expresion);
+	Expresion* expresion, char const* fuente) {
+	Expresion* simplificada = NULL;
+	if (expresion) {
+		// La expresion vive lo que viva el alias: le quitamos el lugar libre.
+		expresion_ajustar(&expresion);
+		uint64_t inicio = traza_comienzo();
+		simplificada = simplificar(expresion, entorno->ops);
+		traza_fin("simplificar", inicio, alias, alias_n,
+			simplificada ? simplificada->n : expresion->n);
+	}
+	if (entorno->especializaciones)
+		descongelar(entorno, ta_encontrar(&entorno->aliases, alias, alias_n));
+	EntradaTablaAlias* entrada = ta_insertar_o_reemplazar(&entorno->aliases,
+		(EntradaTablaAlias){
+			.input = input,
+			.alias = alias,
+			.alias_n = alias_n,
+			.expresion = expresion,
+			.fuente = expresion ? NULL : fuente,
+			.simplificada = simplificada,
+		});
+	// Una carga perezosa agrega sus dependencias al armar sus expresiones.
+	dependencias_definir(&entorno->dependencias, entrada->alias,
+		entrada->alias_n, expresion);
+	pila_ajustar_alias(entorno, entrada->alias, entrada->alias_n);
+	notificar_observados(entorno, entrada->alias, entrada->alias_n);
 }
 
-// Parsea el input y procede de acuerdo al tipo de sentencia ingresada.
-void interpretar(TablaOps* tablaOps) {
-	Entorno entorno = entorno_crear(); // creamos el entorno de la sesion.
-	// Solo nos detenemos cuando el usuario ingrese la palabra clave 'salir'.
-	while (1) {
-		printf("> "); // inicio de linea
-		leer_input(&entorno); // leemos el input
-		Parseado parseado = parsear(entorno.bufferInput, tablaOps); // parseamos
-		Sentencia sentencia = parseado.sentencia; // obtenemos la sentencia
-
-		// Determinamos el tipo de sentencia.
-		switch (sentencia.tag) {
-		case S_CARGA:
-			// Cargamos el alias.
-			cargar(&entorno, robar_input(&entorno),
-				sentencia.alias, sentencia.alias_n, sentencia.expresion);
+// Quita el alias de la tabla de alias, e informa los cambios en los alias
+// observados. La entrada, con su input y sus expresiones, se libera si no esta
+// en ninguna instantanea. Los alias que lo usan quedan con un alias no
+// definido, como si nunca se hubiera cargado.
+static int borrar(Entorno* entorno, char const* alias, int alias_n) {
+	if (entorno->especializaciones)
+		descongelar(entorno, ta_encontrar(&entorno->aliases, alias, alias_n));
+	if (!ta_borrar(&entorno->aliases, alias, alias_n)) {
+		manejar_error(entorno->salida, E_INTERPRETE_ALIAS, &alias, &alias_n);
+		return 0;
+	}
+	dependencias_definir(&entorno->dependencias, alias, alias_n, NULL);
+	pila_ajustar_alias(entorno, alias, alias_n);
+	notificar_observados(entorno, alias, alias_n);
+	return 1;
+}
+
+// Agrega la carga o el borrado al diario, de haberlo. Una carga perezosa se
+// guarda con su texto, sin armarla (ver 'diario_registrar').
+static void registrar(Entorno* entorno, Sentencia sentencia) {
+	if (entorno->diario == NULL)
+		return;
+	diario_registrar(entorno->diario, sentencia, entorno->aliases.cantidad);
+}
+
+// Agrega al diario lo que cambio al pasar de la tabla 'anterior' a la actual:
+// los alias que ya no estan se borran, y los que tienen otra entrada se
+// cargan.
+static void registrar_cambios(Entorno* entorno, TablaAlias* anterior) {
+	int n = anterior->cantidad > entorno->aliases.cantidad ?
+		anterior->cantidad : entorno->aliases.cantidad;
+	EntradaTablaAlias** entradas = malloc((n + 1) * sizeof(EntradaTablaAlias*));
+	assert(entradas);
+	ta_listar(anterior, entradas);
+	for (int i = 0; i < anterior->cantidad; ++i)
+		if (!ta_encontrar(&entorno->aliases, entradas[i]->alias,
+			entradas[i]->alias_n))
+			registrar(entorno, (Sentencia){
+				.tag = S_BORRAR,
+				.alias = entradas[i]->alias,
+				.alias_n = entradas[i]->alias_n,
+			});
+	ta_listar(&entorno->aliases, entradas);
+	for (int i = 0; i < entorno->aliases.cantidad; ++i)
+		if (ta_encontrar(anterior, entradas[i]->alias, entradas[i]->alias_n) !=
+			entradas[i])
+			registrar(entorno, (Sentencia){
+				.tag = S_CARGA,
+				.alias = entradas[i]->alias,
+				.alias_n = entradas[i]->alias_n,
+				.expresion = entradas[i]->expresion,
+				.fuente = entradas[i]->fuente,
+			});
+	free(entradas);
+}
+
+// Devuelve la cantidad de bytes reservados por el entorno: los alias (de la
+// tabla actual y de las instantaneas, contando una vez lo compartido), el
+// buffer del input, el borrador del parser, la pila, el indice de
+// dependencias, los observados y las especializaciones.
+static size_t memoria(Entorno* entorno) {
+	// Comenzamos un recorrido nuevo, que marca lo ya contado.
+	int marca = ++entorno->generacion;
+	size_t bytes = ta_memoria(&entorno->aliases, marca);
+	for (int i = 0; i < entorno->cantidadInstantaneas; ++i)
+		bytes += ta_memoria(&entorno->instantaneas[i], marca);
+	bytes += entorno->capacidadInstantaneas * sizeof(TablaAlias);
+	bytes += entorno->tamanoBufferInput;
+	if (entorno->borrador)
+		bytes += sizeof(Expresion) + entorno->borrador->capacidad * sizeof(Nodo);
+	bytes += entorno->pilaCapacidad * sizeof(int);
+	bytes += dependencias_memoria(&entorno->dependencias);
+	for (Observado* it = entorno->observados; it; it = it->sig)
+		bytes += sizeof(Observado) + it->alias_n;
+	for (Especializacion* it = entorno->especializaciones; it; it = it->sig)
+		bytes += sizeof(Especializacion) + sizeof(Expresion) +
+			it->residual->capacidad * sizeof(Nodo) +
+			it->cantidadCongeladas * sizeof(EntradaTablaAlias*);
+	return bytes;
+}
+
+// Si el alias es valido, lo evalua e imprime el resultado.
+static void evaluar(Entorno* entorno, char const* alias, int alias_n) {
+	int resultado;
+	if (evaluar_acotado(entorno, alias, alias_n, 1, &resultado, NULL))
+		fprintf(entorno->salida, "%d\n", resultado);
+}
+
+// Un operando durante la especializacion: si es constante, su valor, y el
+// primer nodo de su residuo.
+typedef struct {
+	int constante;
+	int valor;
+	int inicio;
+} Parcial;
+
+// Estado de 'especializar'. Los residuos de los alias congelados se arman uno
+// detras de otro en 'residuos', cada uno despues de los de sus dependencias,
+// por lo que los nodos de operacion guardan posiciones dentro de 'residuos'.
+typedef struct {
+	Entorno* entorno;
+	Expresion* residuos;
+	Parcial* pila;
+	int capacidadPila;
+	EntradaTablaAlias** congeladas;
+	int cantidadCongeladas;
+	int capacidadCongeladas;
+	int excedido; // si se supero LIMITE_RESIDUO.
+} Especializador;
+
+// Agrega el nodo a los residuos, controlando su tamano. Devuelve 0 si se
+// excedio el limite.
+static int residuo_agregar(Especializador* especializador, Nodo nodo) {
+	if (especializador->residuos->n == LIMITE_RESIDUO) {
+		especializador->excedido = 1;
+		return 0;
+	}
+	expresion_agregar(&especializador->residuos, nodo);
+	return 1;
+}
+
+// Arma el residuo del alias congelado de la entrada, y antes los de los alias
+// congelados de los que depende. Si el residuo es constante, guarda su valor
+// en 'indice' y 'tamano' queda en 0; si no, ocupa los nodos
+// [indice, indice + tamano) de los residuos. Los alias variables (marcados de
+// antemano) quedan como nodos de alias.
+// Devuelve 0 si se agoto el presupuesto o se excedio el limite.
+static int especializar_alias(Especializador* especializador,
+	EntradaTablaAlias* entrada) {
+	Entorno* entorno = especializador->entorno;
+	entrada->marca = entorno->generacion;
+	entrada->alcanza = 0;
+	if (especializador->cantidadCongeladas ==
+		especializador->capacidadCongeladas) {
+		especializador->capacidadCongeladas =
+			especializador->capacidadCongeladas ?
+				2 * especializador->capacidadCongeladas : 8;
+		especializador->congeladas = realloc(especializador->congeladas,
+			especializador->capacidadCongeladas * sizeof(EntradaTablaAlias*));
+		assert(especializador->congeladas);
+	}
+	especializador->congeladas[especializador->cantidadCongeladas++] = entrada;
+
+	// Primero los alias congelados de los que depende (ya fue chequeado, por lo
+	// que estan definidos y no hay ciclos). Si el alias ya esta especializado,
+	// se recorre su expresion definida: asi sus alias congelados tambien
+	// quedan congelados en esta especializacion.
+	Expresion* expresion = expresion_definida(entorno, entrada);
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (nodo->tag != X_ALIAS)
+			continue;
+		EntradaTablaAlias* sub =
+			ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor);
+		if (sub->marca != entorno->generacion &&
+			!especializar_alias(especializador, sub))
+			return 0;
+	}
+
+	if (especializador->capacidadPila < expresion->n) {
+		especializador->capacidadPila = expresion->n;
+		especializador->pila = realloc(especializador->pila,
+			expresion->n * sizeof(Parcial));
+		assert(especializador->pila);
+	}
+	Parcial* pila = especializador->pila;
+	int tope = 0;
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo nodo = expresion->nodos[i];
+		int fin = especializador->residuos->n;
+		if (!presupuesto_nodo(entorno))
+			return 0;
+		switch (nodo.tag) {
+		case X_OPERACION: {
+			EntradaTablaOps* op = operador(entorno, &nodo);
+			tope -= op->aridad;
+			Parcial* args = &pila[tope];
+			int constante = args[0].constante &&
+				(op->aridad == 1 || args[1].constante);
+			if (constante) {
+				if (entorno->operacionesRestantes-- == 0) {
+					entorno->agotado = 1;
+					return 0;
+				}
+				// Los argumentos van del ultimo operando al primero.
+				int valores[2] = {args[op->aridad - 1].valor, args[0].valor};
+				int valor = op->eval(valores);
+				especializador->residuos->n = args[0].inicio;
+				pila[tope++] = (Parcial){1, valor, args[0].inicio};
+				if (!residuo_agregar(especializador,
+					(Nodo){.tag = X_NUMERO, .valor = valor}))
+					return 0;
+			}
+			else {
+				pila[tope++] = (Parcial){0, 0, args[0].inicio};
+				nodo.valor = args[0].inicio;
+				if (!residuo_agregar(especializador, nodo))
+					return 0;
+			}
+		} break;
+		case X_CADENA: {
+			// Si todos los operandos son constantes, la reducimos. Si no, la
+			// cadena queda en el residuo (con los operandos constantes ya
+			// evaluados); su valor es la cantidad, por lo que no se mueve.
+			int cantidad = nodo.valor;
+			tope -= cantidad;
+			Parcial* args = &pila[tope];
+			int constante = 1;
+			for (int k = 0; k < cantidad && constante; ++k)
+				constante = args[k].constante;
+			if (constante) {
+				if (entorno->operacionesRestantes < cantidad - 1) {
+					entorno->agotado = 1;
+					return 0;
+				}
+				entorno->operacionesRestantes -= cantidad - 1;
+				// Los argumentos van del ultimo operando al primero.
+				EntradaTablaOps* op = operador(entorno, &nodo);
+				int valores[2] = {0, args[0].valor};
+				for (int k = 1; k < cantidad; ++k) {
+					valores[0] = args[k].valor;
+					valores[1] = op->eval(valores);
+				}
+				int valor = valores[1];
+				int inicio = args[0].inicio;
+				especializador->residuos->n = inicio;
+				pila[tope++] = (Parcial){1, valor, inicio};
+				if (!residuo_agregar(especializador,
+					(Nodo){.tag = X_NUMERO, .valor = valor}))
+					return 0;
+			}
+			else {
+				pila[tope++] = (Parcial){0, 0, args[0].inicio};
+				if (!residuo_agregar(especializador, nodo))
+					return 0;
+			}
+		} break;
+		case X_NUMERO:
+			pila[tope++] = (Parcial){1, nodo.valor, fin};
+			if (!residuo_agregar(especializador, nodo))
+				return 0;
 			break;
-		case S_IMPRIMIR:
-			// Imprimimos el alias.
-			imprimir(&entorno, sentencia.alias, sentencia.alias_n);
+		case X_ALIAS: {
+			EntradaTablaAlias* sub =
+				ta_encontrar(&entorno->aliases, nodo.alias, nodo.valor);
+			if (sub->alcanza) {
+				pila[tope++] = (Parcial){0, 0, fin};
+				if (!residuo_agregar(especializador, nodo))
+					return 0;
+			}
+			else if (sub->tamano == 0) {
+				pila[tope++] = (Parcial){1, sub->indice, fin};
+				if (!residuo_agregar(especializador,
+					(Nodo){.tag = X_NUMERO, .valor = sub->indice}))
+					return 0;
+			}
+			else {
+				// Copiamos su residuo, que esta antes, moviendo las posiciones.
+				pila[tope++] = (Parcial){0, 0, fin};
+				for (size_t k = 0; k < sub->tamano; ++k) {
+					Nodo copia = especializador->residuos->nodos[sub->indice + k];
+					if (copia.tag == X_OPERACION)
+						copia.valor += fin - sub->indice;
+					if (!residuo_agregar(especializador, copia))
+						return 0;
+				}
+			}
+		} break;
+		}
+	}
+	entrada->indice = pila[0].constante ? pila[0].valor : pila[0].inicio;
+	entrada->tamano = pila[0].constante ? 0 :
+		(size_t)(especializador->residuos->n - pila[0].inicio);
+	return 1;
+}
+
+// Especializa el alias: evalua una vez todo lo que no depende de los alias
+// variables, y guarda la expresion residual, que se evalua en su lugar hasta
+// que se redefina alguno de los alias congelados (los demas alias de los que
+// depende, sin contar los que solo se alcanzan a traves de los variables).
+// Especializar de nuevo un alias reemplaza su especializacion anterior.
+static int especializar(Entorno* entorno, char const* alias, int alias_n,
+	Expresion* variables) {
+	for (int i = 0; i < variables->n; ++i) {
+		Nodo const* nodo = &variables->nodos[i];
+		if (nodo->valor == alias_n && memcmp(nodo->alias, alias, alias_n) == 0) {
+			manejar_error(entorno->salida, E_INTERPRETE_CICLO, &alias, &alias_n);
+			return 0;
+		}
+	}
+	entorno->chequeos += 1;
+	int altura;
+	ErrorTag error;
+	if (!chequear_alias(entorno, alias, alias_n, 1, &altura, &error)) {
+		if (entorno->agotado)
+			manejar_error(entorno->salida, E_INTERPRETE_PRESUPUESTO, &alias,
+				&alias_n);
+		return 0;
+	}
+	// Quitamos la especializacion anterior, para partir de sus expresiones.
+	EntradaTablaAlias* entrada = ta_encontrar(&entorno->aliases, alias, alias_n);
+	for (Especializacion** it = &entorno->especializaciones; *it;
+		it = &(*it)->sig) {
+		if ((*it)->congeladas[0] == entrada) {
+			*it = especializacion_descartar(*it);
 			break;
-		case S_EVALUAR:
-			// Si es valido, evaluamos el alias e imprimimos el resultado.
-			if (chequear_alias(&entorno, sentencia.alias, sentencia.alias_n)) {
-				int resultado = 
-					evaluar_alias(&entorno, sentencia.alias, sentencia.alias_n);
-				printf("%d\n", resultado);
+		}
+	}
+
+	// Marcamos los alias variables, y recorremos desde el alias.
+	entorno->generacion += 1;
+	for (int i = 0; i < variables->n; ++i) {
+		Nodo const* nodo = &variables->nodos[i];
+		EntradaTablaAlias* variable =
+			ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor);
+		if (variable) {
+			variable->marca = entorno->generacion;
+			variable->alcanza = 1;
+		}
+	}
+	Especializador especializador = {
+		.entorno = entorno,
+		.residuos = expresion_crear(64),
+	};
+	int ok = especializar_alias(&especializador, entrada);
+	if (ok) {
+		Expresion* residual;
+		if (entrada->tamano == 0) {
+			residual = expresion_crear(1);
+			expresion_numero(&residual, entrada->indice);
+		}
+		else {
+			// Copiamos el residuo del alias, con las posiciones desde 0.
+			residual = expresion_crear(entrada->tamano);
+			for (size_t k = 0; k < entrada->tamano; ++k) {
+				Nodo nodo = especializador.residuos->nodos[entrada->indice + k];
+				if (nodo.tag == X_OPERACION)
+					nodo.valor -= entrada->indice;
+				expresion_agregar(&residual, nodo);
 			}
+		}
+		Especializacion* especializacion = malloc(sizeof(*especializacion));
+		assert(especializacion);
+		*especializacion = (Especializacion){
+			.sig = entorno->especializaciones,
+			.residual = residual,
+			.congeladas = especializador.congeladas,
+			.cantidadCongeladas = especializador.cantidadCongeladas,
+		};
+		for (int i = 0; i < especializador.cantidadCongeladas; ++i) {
+			ta_retener(especializador.congeladas[i]);
+			especializador.congeladas[i]->congelada += 1;
+		}
+		entrada->residual = residual;
+		entorno->especializaciones = especializacion;
+		pila_ajustar_alias(entorno, alias, alias_n);
+	}
+	else {
+		manejar_error(entorno->salida, especializador.excedido ?
+			E_INTERPRETE_RESIDUO : E_INTERPRETE_PRESUPUESTO, &alias, &alias_n);
+		free(especializador.congeladas);
+	}
+	expresion_limpiar(especializador.residuos);
+	free(especializador.pila);
+	return ok;
+}
+
+// Estado de 'evaluar todos'. Los alias se numeran en orden de definicion, y
+// se agrupan por nivel: el nivel de un alias es uno mas que el maximo nivel
+// de los alias de los que depende directamente. Los alias de un mismo nivel
+// no dependen entre si, por lo que se evaluan en paralelo.
+typedef struct {
+	Entorno* entorno;
+	int n;
+	EntradaTablaAlias** entradas;
+	Expresion** expresiones; // la expresion que se evalua de cada alias.
+	int* nivel;              // -1 si el alias no puede evaluarse.
+	int* valor;
+	// Si no puede evaluarse, el error y el alias que lo causa.
+	ErrorTag* error;
+	char const** causa;
+	int* causa_n;
+	// Las dependencias del alias i, en el orden de sus nodos de alias, ocupan
+	// el tramo [inicioDeps[i], inicioDeps[i + 1]) de 'deps'. Cada una es el
+	// indice del alias, o -(nodo + 1) si el alias del nodo no esta definido.
+	int* inicioDeps;
+	int* deps;
+	int cantidadDeps;
+	int capacidadDeps;
+	// Para hallar los ciclos (ver 'lote_nivelar'): el numero de visita de cada
+	// alias, el menor numero de visita que alcanza entre los alias cuya
+	// componente no se cerro, y esos alias, en orden de visita.
+	int* visita;
+	int* bajo;
+	int visitados;
+	int* pendientes;
+	int cantidadPendientes;
+	// Los alias ordenados por nivel, y el comienzo del nivel que se evalua.
+	int* orden;
+	int inicioNivel;
+} Lote;
+
+// Agrega una dependencia al lote.
+static void lote_agregar_dep(Lote* lote, int dep) {
+	if (lote->cantidadDeps == lote->capacidadDeps) {
+		lote->capacidadDeps = lote->capacidadDeps ? 2 * lote->capacidadDeps : 64;
+		lote->deps = realloc(lote->deps, lote->capacidadDeps * sizeof(int));
+		assert(lote->deps);
+	}
+	lote->deps[lote->cantidadDeps++] = dep;
+}
+
+// Marca al alias i como imposible de evaluar.
+static void lote_fallar(Lote* lote, int i, ErrorTag error, char const* causa,
+	int causa_n) {
+	lote->nivel[i] = -1;
+	lote->error[i] = error;
+	lote->causa[i] = causa;
+	lote->causa_n[i] = causa_n;
+}
+
+// Calcula el nivel del alias i y, antes, el de los alias de los que depende.
+// Los ciclos se hallan con el algoritmo de Tarjan: cada alias de un ciclo
+// informa que depende de si mismo (como al evaluarlo). Si no esta en un
+// ciclo, pero depende de un alias no definido o de uno que no puede
+// evaluarse, hereda el primer error de izquierda a derecha (asi, los alias que
+// llevan a un ciclo informan el primer alias del ciclo que alcanzan).
+static void lote_nivelar(Lote* lote, int i) {
+	Entorno* entorno = lote->entorno;
+	EntradaTablaAlias* entrada = lote->entradas[i];
+	entrada->marca = entorno->generacion;
+	entrada->enCurso = 1;
+	lote->nivel[i] = 0;
+	lote->visita[i] = lote->bajo[i] = lote->visitados++;
+	lote->pendientes[lote->cantidadPendientes++] = i;
+
+	// Anotamos las dependencias, antes de recorrerlas, para que ocupen un
+	// tramo contiguo.
+	Expresion* expresion = expresion_evaluable(entorno, entrada);
+	lote->expresiones[i] = expresion;
+	int inicio = lote->cantidadDeps;
+	for (int k = 0; k < expresion->n; ++k) {
+		Nodo const* nodo = &expresion->nodos[k];
+		if (nodo->tag != X_ALIAS)
+			continue;
+		EntradaTablaAlias* sub = 
+			ta_encontrar(&entorno->aliases, nodo->alias, nodo->valor);
+		lote_agregar_dep(lote, sub ? sub->indice : -(k + 1));
+	}
+	int fin = lote->cantidadDeps;
+	lote->inicioDeps[i] = inicio;
+
+	// Recorremos todas las dependencias, aunque el alias ya haya fallado, para
+	// saber si esta en un ciclo.
+	int enCiclo = 0;
+	for (int d = inicio; d < fin; ++d) {
+		int j = lote->deps[d];
+		if (j < 0) {
+			Nodo const* nodo = &expresion->nodos[-j - 1];
+			if (lote->nivel[i] >= 0)
+				lote_fallar(lote, i, E_INTERPRETE_ALIAS, nodo->alias, nodo->valor);
+			continue;
+		}
+		EntradaTablaAlias* sub = lote->entradas[j];
+		if (sub->marca != entorno->generacion) {
+			lote_nivelar(lote, j);
+			if (lote->bajo[j] < lote->bajo[i])
+				lote->bajo[i] = lote->bajo[j];
+		}
+		if (sub->enCurso) {
+			// Esta en la misma componente que el alias: es un ciclo.
+			if (lote->visita[j] < lote->bajo[i])
+				lote->bajo[i] = lote->visita[j];
+			enCiclo = 1;
+		}
+		else if (lote->nivel[i] < 0)
+			continue;
+		else if (lote->nivel[j] < 0)
+			lote_fallar(lote, i, lote->error[j], lote->causa[j], lote->causa_n[j]);
+		else if (lote->nivel[j] + 1 > lote->nivel[i])
+			lote->nivel[i] = lote->nivel[j] + 1;
+	}
+
+	// Si el alias es la raiz de su componente, la cerramos: si es un ciclo,
+	// cada uno de sus alias depende de si mismo.
+	if (lote->bajo[i] != lote->visita[i])
+		return;
+	int j;
+	do {
+		j = lote->pendientes[--lote->cantidadPendientes];
+		EntradaTablaAlias* miembro = lote->entradas[j];
+		miembro->enCurso = 0;
+		if (enCiclo)
+			lote_fallar(lote, j, E_INTERPRETE_CICLO, miembro->alias,
+				miembro->alias_n);
+	} while (j != i);
+}
+
+// Evalua el k-esimo alias del nivel actual. Los valores de sus dependencias
+// ya fueron calculados en niveles anteriores, por lo que no hace falta
+// recorrerlas: cada nodo de alias toma el valor de su dependencia.
+static void lote_evaluar(void* lote_, int k) {
+	Lote* lote = lote_;
+	int i = lote->orden[lote->inicioNivel + k];
+	Expresion* expresion = lote->expresiones[i];
+	int* dep = &lote->deps[lote->inicioDeps[i]];
+	// Cada hilo usa su propia pila.
+	int local[64];
+	int* pila = expresion->n <= 64 ? local : malloc(expresion->n * sizeof(int));
+	assert(pila);
+	int tope = 0;
+	for (int j = 0; j < expresion->n; ++j) {
+		Nodo const* nodo = &expresion->nodos[j];
+		switch (nodo->tag) {
+		case X_OPERACION: {
+			EntradaTablaOps* op = operador(lote->entorno, nodo);
+			int args[2] = {pila[tope - 1], op->aridad == 2 ? pila[tope - 2] : 0};
+			tope -= op->aridad;
+			pila[tope++] = op->eval(args);
+		} break;
+		case X_CADENA:
+			tope -= nodo->valor;
+			pila[tope] = tabla_ops_reducir(operador(lote->entorno, nodo),
+				&pila[tope], nodo->valor);
+			tope += 1;
 			break;
-		case S_INVALIDO:
-			// Manejamos el error.
-			manejar_error(parseado.error, &parseado.resto, NULL);
+		case X_NUMERO:
+			pila[tope++] = nodo->valor;
 			break;
-		case S_SALIR:
-			// Limpiamos el entorno y terminamos el programa.
-			entorno_limpiar_datos(&entorno);
+		case X_ALIAS:
+			pila[tope++] = lote->valor[*dep++];
+			break;
+		}
+	}
+	lote->valor[i] = pila[--tope];
+	if (pila != local)
+		free(pila);
+}
+
+// Evalua todos los alias definidos, cada uno una sola vez, y luego imprime
+// sus valores (o el error que impide evaluarlos) en orden de definicion.
+static void evaluar_todos(Entorno* entorno) {
+	Lote lote = { .entorno = entorno, .n = entorno->aliases.cantidad };
+	int n = lote.n;
+	lote.entradas = malloc(n * sizeof(*lote.entradas));
+	lote.expresiones = malloc(n * sizeof(*lote.expresiones));
+	lote.nivel = malloc(n * sizeof(int));
+	lote.valor = malloc(n * sizeof(int));
+	lote.error = malloc(n * sizeof(*lote.error));
+	lote.causa = malloc(n * sizeof(*lote.causa));
+	lote.causa_n = malloc(n * sizeof(int));
+	lote.inicioDeps = malloc(n * sizeof(int));
+	lote.visita = malloc(n * sizeof(int));
+	lote.bajo = malloc(n * sizeof(int));
+	lote.pendientes = malloc(n * sizeof(int));
+	lote.orden = malloc(n * sizeof(int));
+	assert(n == 0 || (lote.entradas && lote.expresiones && lote.nivel &&
+		lote.valor && lote.error && lote.causa && lote.causa_n &&
+		lote.inicioDeps && lote.visita && lote.bajo && lote.pendientes &&
+		lote.orden));
+
+	ta_listar(&entorno->aliases, lote.entradas);
+	int i;
+	for (i = 0; i < n; ++i)
+		lote.entradas[i]->indice = i;
+
+	// Calculamos los niveles (y armamos las expresiones de las cargas
+	// perezosas, que no pueden armarse en paralelo).
+	uint64_t inicio = traza_comienzo();
+	entorno->generacion += 1;
+	int niveles = 0;
+	for (i = 0; i < n; ++i) {
+		if (lote.entradas[i]->marca != entorno->generacion)
+			lote_nivelar(&lote, i);
+		if (lote.nivel[i] + 1 > niveles)
+			niveles = lote.nivel[i] + 1;
+	}
+	traza_fin("ordenar_lote", inicio, NULL, 0, n);
+
+	// Ordenamos los alias por nivel (counting sort), y evaluamos cada nivel
+	// en paralelo si tiene suficientes nodos. Los hilos se crean una sola vez,
+	// con el primer nivel que se evalua en paralelo.
+	int* inicioNiveles = calloc(niveles + 1, sizeof(int));
+	assert(inicioNiveles);
+	for (i = 0; i < n; ++i)
+		if (lote.nivel[i] >= 0)
+			inicioNiveles[lote.nivel[i] + 1] += 1;
+	for (int l = 0; l < niveles; ++l)
+		inicioNiveles[l + 1] += inicioNiveles[l];
+	for (i = 0; i < n; ++i)
+		if (lote.nivel[i] >= 0)
+			lote.orden[inicioNiveles[lote.nivel[i]]++] = i;
+	Equipo* equipo = NULL;
+	for (int l = 0; l < niveles; ++l) {
+		inicio = traza_comienzo();
+		lote.inicioNivel = l ? inicioNiveles[l - 1] : 0;
+		int cantidad = inicioNiveles[l] - lote.inicioNivel;
+		long long nodos = 0;
+		for (int k = 0; k < cantidad; ++k)
+			nodos += lote.expresiones[lote.orden[lote.inicioNivel + k]]->n;
+		if (nodos >= NODOS_NIVEL_PARALELO && cantidad > 1 &&
+			entorno->opciones.hilos > 1) {
+			if (equipo == NULL)
+				equipo = equipo_crear(entorno->opciones.hilos);
+			equipo_para(equipo, cantidad, lote_evaluar, &lote);
+		}
+		else
+			for (int k = 0; k < cantidad; ++k)
+				lote_evaluar(&lote, k);
+		traza_fin("evaluar_nivel", inicio, NULL, 0, cantidad);
+	}
+	if (equipo != NULL)
+		equipo_liberar(equipo);
+
+	for (i = 0; i < n; ++i) {
+		EntradaTablaAlias* entrada = lote.entradas[i];
+		fprintf(entorno->salida, "%.*s = ", entrada->alias_n, entrada->alias);
+		if (lote.nivel[i] >= 0)
+			fprintf(entorno->salida, "%d\n", lote.valor[i]);
+		else
+			manejar_error(entorno->salida, lote.error[i], &lote.causa[i],
+				&lote.causa_n[i]);
+	}
+
+	free(inicioNiveles);
+	free(lote.entradas);
+	free(lote.expresiones);
+	free(lote.nivel);
+	free(lote.valor);
+	free(lote.error);
+	free(lote.causa);
+	free(lote.causa_n);
+	free(lote.inicioDeps);
+	free(lote.deps);
+	free(lote.visita);
+	free(lote.bajo);
+	free(lote.pendientes);
+	free(lote.orden);
+}
+
+// Guarda la version actual de la tabla de alias, e imprime su numero. La
+// tabla es persistente, por lo que guardarla cuesta O(1).
+static int instantanea(Entorno* entorno) {
+	if (entorno->cantidadInstantaneas == entorno->capacidadInstantaneas) {
+		entorno->capacidadInstantaneas = entorno->capacidadInstantaneas ?
+			2 * entorno->capacidadInstantaneas : 8;
+		entorno->instantaneas = realloc(entorno->instantaneas,
+			entorno->capacidadInstantaneas * sizeof(TablaAlias));
+		assert(entorno->instantaneas);
+	}
+	entorno->instantaneas[entorno->cantidadInstantaneas] =
+		ta_copiar(&entorno->aliases);
+	return entorno->cantidadInstantaneas++;
+}
+
+// Rearma el indice de dependencias a partir de las entradas de la tabla
+// actual, al cambiarla entera. Los alias que todavia no armaron sus
+// expresiones (por la carga perezosa) se agregan al armarlas.
+static void dependencias_reconstruir(Entorno* entorno,
+	EntradaTablaAlias** entradas) {
+	dependencias_limpiar(&entorno->dependencias);
+	for (int i = 0; i < entorno->aliases.cantidad; ++i)
+		dependencias_definir(&entorno->dependencias, entradas[i]->alias,
+			entradas[i]->alias_n, entradas[i]->expresion);
+	for (Observado* it = entorno->observados; it; it = it->sig)
+		dependencias_asociar(&entorno->dependencias, it->alias, it->alias_n, it);
+}
+
+// Vuelve a la version de la tabla de alias guardada en la instantanea dada,
+// que sigue disponible. Como pueden cambiar todos los valores, se actualizan
+// todos los observados.
+static int restaurar(Entorno* entorno, int numero) {
+	if (numero < 0 || numero >= entorno->cantidadInstantaneas) {
+		manejar_error(entorno->salida, E_INTERPRETE_INSTANTANEA, NULL, NULL);
+		return 0;
+	}
+	ta_limpiar(&entorno->aliases);
+	entorno->aliases = ta_copiar(&entorno->instantaneas[numero]);
+	// Las especializaciones siguen valiendo si sus alias congelados tienen las
+	// mismas entradas en la tabla restaurada.
+	Especializacion** esp = &entorno->especializaciones;
+	while (*esp) {
+		int vigente = 1;
+		for (int i = 0; i < (*esp)->cantidadCongeladas && vigente; ++i) {
+			EntradaTablaAlias* entrada = (*esp)->congeladas[i];
+			vigente = ta_encontrar(&entorno->aliases, entrada->alias,
+				entrada->alias_n) == entrada;
+		}
+		if (vigente)
+			esp = &(*esp)->sig;
+		else
+			*esp = especializacion_descartar(*esp);
+	}
+	// Cambiaron todas las entradas: rearmamos el indice y la pila.
+	EntradaTablaAlias** entradas =
+		malloc((entorno->aliases.cantidad + 1) * sizeof(EntradaTablaAlias*));
+	assert(entradas);
+	ta_listar(&entorno->aliases, entradas);
+	dependencias_reconstruir(entorno, entradas);
+	pila_ajustar(entorno, entradas, entorno->aliases.cantidad);
+	free(entradas);
+	notificar_observados(entorno, NULL, 0);
+	return 1;
+}
+
+// Procede de acuerdo al tipo de sentencia ingresada. Si es una carga, la
+// entrada se queda con una copia del input (de haberlo).
+// Devuelve 0 si la sentencia es 'salir'.
+static int ejecutar(Entorno* entorno, Parseado parseado,
+	uint64_t inicioSentencia) {
+	Sentencia sentencia = parseado.sentencia;
+	presupuesto_renovar(entorno);
+	uint64_t inicio = traza_comienzo();
+	switch (sentencia.tag) {
+	case S_CARGA: {
+		// Registramos la carga en el diario antes de aplicarla, y cargamos el
+		// alias con su propia copia del input.
+		registrar(entorno, sentencia);
+		char* input = copiar_input(entorno, &sentencia);
+		int nodos = sentencia.expresion ? sentencia.expresion->n : -1;
+		cargar(entorno, input, sentencia.alias, sentencia.alias_n,
+			sentencia.expresion, sentencia.fuente);
+		traza_fin("cargar", inicio, sentencia.alias, sentencia.alias_n, nodos);
+		} break;
+	case S_IMPRIMIR:
+		// Imprimimos el alias.
+		imprimir(entorno, sentencia.alias, sentencia.alias_n);
+		traza_fin("imprimir_expresion", inicio, sentencia.alias,
+			sentencia.alias_n, trazaActiva ?
+				nodos_alias(entorno, sentencia.alias, sentencia.alias_n) : -1);
+		break;
+	case S_MOSTRAR:
+		// Mostramos el alias con sus alias compartidos.
+		mostrar(entorno, sentencia.alias, sentencia.alias_n);
+		traza_fin("mostrar", inicio, sentencia.alias, sentencia.alias_n,
+			trazaActiva ? nodos_alias(entorno, sentencia.alias, sentencia.alias_n) :
+				-1);
+		break;
+	case S_OBSERVAR:
+		// Registramos el alias como observado.
+		observar(entorno, sentencia.alias, sentencia.alias_n);
+		traza_fin("observar", inicio, sentencia.alias, sentencia.alias_n, -1);
+		break;
+	case S_EVALUAR:
+		// Si es valido, evaluamos el alias e imprimimos el resultado.
+		evaluar(entorno, sentencia.alias, sentencia.alias_n);
+		break;
+	case S_INSTANTANEA:
+		// Guardamos la tabla de alias e informamos su numero.
+		fprintf(entorno->salida, "instantanea %d\n", instantanea(entorno));
+		traza_fin("instantanea", inicio, NULL, 0, -1);
+		break;
+	case S_RESTAURAR: {
+		// Volvemos a la tabla de alias guardada, y registramos en el diario lo
+		// que cambio.
+		TablaAlias anterior = entorno->diario ?
+			ta_copiar(&entorno->aliases) : ta_crear();
+		if (restaurar(entorno, sentencia.numero) && entorno->diario)
+			registrar_cambios(entorno, &anterior);
+		ta_limpiar(&anterior);
+		traza_fin("restaurar", inicio, NULL, 0, -1);
+		} break;
+	case S_BORRAR:
+		// Quitamos el alias, y registramos el borrado en el diario.
+		if (borrar(entorno, sentencia.alias, sentencia.alias_n))
+			registrar(entorno, sentencia);
+		traza_fin("borrar", inicio, sentencia.alias, sentencia.alias_n, -1);
+		break;
+	case S_ESPECIALIZAR:
+		// Especializamos el alias, y liberamos la lista de variables.
+		especializar(entorno, sentencia.alias, sentencia.alias_n,
+			sentencia.expresion);
+		expresion_limpiar(sentencia.expresion);
+		traza_fin("especializar", inicio, sentencia.alias, sentencia.alias_n, -1);
+		break;
+	case S_MEMORIA:
+		// Informamos los bytes reservados.
+		fprintf(entorno->salida, "%zu bytes\n", memoria(entorno));
+		traza_fin("memoria", inicio, NULL, 0, -1);
+		break;
+	case S_EVALUAR_TODOS:
+		// Evaluamos todos los alias e imprimimos los resultados.
+		evaluar_todos(entorno);
+		traza_fin("evaluar_todos", inicio, NULL, 0, -1);
+		break;
+	case S_INVALIDO:
+		// Manejamos el error.
+		manejar_error(entorno->salida, parseado.error, &parseado.resto, NULL);
+		break;
+	case S_SALIR:
+		return 0;
+	}
+	traza_fin("sentencia", inicioSentencia, sentencia.alias,
+		sentencia.alias_n, -1);
+	return 1;
+}
+
+// Informa, una sola vez, si fallo la escritura del diario. Desde entonces el
+// diario ya no registra nada, pero la sesion sigue.
+static void revisar_diario(Entorno* entorno) {
+	if (entorno->diario == NULL || entorno->diarioFallo ||
+		!diario_fallo(entorno->diario))
+		return;
+	fprintf(stderr, "ERROR: no se pudo escribir el diario \'%s\'.\n",
+		entorno->opciones.diario);
+	entorno->diarioFallo = 1;
+}
+
+// Lee las sentencias de texto, una por linea, y las ejecuta.
+static void interpretar_texto(Entorno* entorno) {
+	reservar_input(entorno);
+	// Solo nos detenemos cuando el usuario ingrese la palabra clave 'salir', o
+	// cuando se termina la entrada.
+	while (1) {
+		fprintf(entorno->salida, "> "); // inicio de linea
+		uint64_t inicioSentencia = traza_comienzo();
+		long long reservas = reservas_contadas();
+		int hayInput = leer_input(entorno); // leemos el input
+		traza_fin("leer_input", inicioSentencia, NULL, 0, -1);
+		if (!hayInput)
 			return;
+		uint64_t inicio = traza_comienzo();
+		Parseado parseado = parsear(entorno->bufferInput, entorno->ops,
+			entorno->opciones.perezoso, entorno->opciones.hilos,
+			&entorno->borrador); // parseamos
+		traza_fin("parsear", inicio, parseado.sentencia.alias,
+			parseado.sentencia.alias_n,
+			parseado.sentencia.expresion ? parseado.sentencia.expresion->n : -1);
+		int seguir = ejecutar(entorno, parseado, inicioSentencia);
+		assert(!solo_lectura(entorno, parseado.sentencia.tag) ||
+			reservas_contadas() == reservas);
+		revisar_diario(entorno);
+		if (!seguir)
+			return;
+	}
+}
+
+// Lee las sentencias en formato binario y las ejecuta. Solo las cargas que
+// traen el texto de su expresion pueden ser perezosas.
+static void interpretar_binario(Entorno* entorno) {
+	LectorBinario lector = lector_binario_crear();
+	while (1) {
+		fprintf(entorno->salida, "> "); // inicio de sentencia
+		uint64_t inicioSentencia = traza_comienzo();
+		Parseado parseado;
+		int hayInput = binario_leer(&lector, entorno->entrada, entorno->ops,
+			&parseado);
+		traza_fin("decodificar", inicioSentencia, parseado.sentencia.alias,
+			parseado.sentencia.alias_n, hayInput && parseado.sentencia.expresion ?
+				parseado.sentencia.expresion->n : -1);
+		// Las declaraciones de alias que preceden a la sentencia son del
+		// lector, por lo que solo se cuentan las reservas de su ejecucion.
+		long long reservas = reservas_contadas();
+		if (!hayInput || !ejecutar(entorno, parseado, inicioSentencia))
+			break;
+		assert(!solo_lectura(entorno, parseado.sentencia.tag) ||
+			reservas_contadas() == reservas);
+		revisar_diario(entorno);
+	}
+	// Los alias de la tabla apuntan al lector, por lo que la limpiamos antes.
+	entorno_limpiar_datos(entorno);
+	lector_binario_limpiar(&lector);
+}
+
+// Aplica una sentencia del diario al reproducirlo: las cargas y los borrados
+// van directo a la tabla, sin informar nada.
+static void reproducir(void* entorno_, Parseado parseado) {
+	Entorno* entorno = entorno_;
+	Sentencia sentencia = parseado.sentencia;
+	if (sentencia.tag == S_CARGA) {
+		char* input = preparar_carga_binaria(entorno, &sentencia);
+		cargar(entorno, input, sentencia.alias, sentencia.alias_n,
+			sentencia.expresion, sentencia.fuente);
+	}
+	else if (sentencia.tag == S_BORRAR) {
+		ta_borrar(&entorno->aliases, sentencia.alias, sentencia.alias_n);
+		dependencias_definir(&entorno->dependencias, sentencia.alias,
+			sentencia.alias_n, NULL);
+		pila_ajustar_alias(entorno, sentencia.alias, sentencia.alias_n);
+	}
+	else if (sentencia.tag == S_ESPECIALIZAR)
+		expresion_limpiar(sentencia.expresion);
+}
+
+int interpretar(TablaOps* tablaOps, OpcionesInterprete opciones,
+	FILE* entrada, FILE* salida) {
+	// creamos el entorno de la sesion.
+	Entorno entorno = entorno_crear(tablaOps, opciones, entrada, salida);
+	// Recuperamos los alias del diario, de haberlo.
+	if (opciones.diario != NULL) {
+		uint64_t inicio = traza_comienzo();
+		entorno.diario = diario_abrir(opciones.diario, tablaOps,
+			&entorno.lectorDiario, reproducir, &entorno);
+		traza_fin("reproducir_diario", inicio, NULL, 0, entorno.aliases.cantidad);
+		if (entorno.diario == NULL) {
+			fprintf(stderr, "ERROR: no se pudo abrir el diario \'%s\'.\n",
+				opciones.diario);
+			entorno_limpiar_datos(&entorno);
+			return 0;
+		}
+	}
+	entorno_preparar(&entorno);
+	// Si la entrada empieza con la marca del formato binario, la decodificamos.
+	// Una terminal es siempre texto: buscar la marca esperaria a que el
+	// usuario escriba, antes de mostrarle el primer "> ".
+	int binario = isatty(fileno(entrada)) ? 0 : binario_detectar(entrada);
+	if (binario < 0) {
+		fprintf(stderr, "ERROR: la entrada no es texto ni formato binario.\n");
+		entorno_limpiar_datos(&entorno);
+		return 0;
+	}
+	if (binario)
+		interpretar_binario(&entorno);
+	else {
+		interpretar_texto(&entorno);
+		entorno_limpiar_datos(&entorno);
+	}
+	return !entorno.diarioFallo;
+}
+
+
+// Interfaz de biblioteca.
+
+// Guarda el error, de haber donde, y devuelve 0.
+static int fallar(ErrorTag* error, ErrorTag tag) {
+	if (error)
+		*error = tag;
+	return 0;
+}
+
+Entorno* entorno_nuevo(TablaOps* tabla) {
+	Entorno* entorno = malloc(sizeof(*entorno));
+	assert(entorno);
+	*entorno = entorno_crear(tabla, (OpcionesInterprete){0}, NULL, NULL);
+	presupuesto_renovar(entorno);
+	return entorno;
+}
+
+void entorno_destruir(Entorno* entorno) {
+	entorno_limpiar_datos(entorno);
+	free(entorno);
+}
+
+int entorno_definir(Entorno* entorno, char const* alias,
+	char const* expresion, ErrorTag* error) {
+	if (parsear_alias(alias, entorno->ops) != (int)strlen(alias))
+		return fallar(error, E_PARSER_ALIAS);
+	// Armamos la sentencia de carga, que la entrada guarda como su input.
+	char* input = malloc(strlen(alias) + strlen(expresion) + sizeof(" = cargar "));
+	assert(input);
+	sprintf(input, "%s = cargar %s", alias, expresion);
+	Parseado parseado = parsear(input, entorno->ops, entorno->opciones.perezoso,
+		entorno->opciones.hilos, &entorno->borrador);
+	Sentencia sentencia = parseado.sentencia;
+	if (sentencia.tag != S_CARGA) {
+		free(input);
+		return fallar(error, parseado.error);
+	}
+	cargar(entorno, input, sentencia.alias, sentencia.alias_n,
+		sentencia.expresion, sentencia.fuente);
+	return 1;
+}
+
+int entorno_definir_expresion(Entorno* entorno, char const* alias,
+	Expresion* expresion, ErrorTag* error) {
+	int alias_n = strlen(alias);
+	if (parsear_alias(alias, entorno->ops) != alias_n) {
+		expresion_limpiar(expresion);
+		return fallar(error, E_PARSER_ALIAS);
+	}
+	// Validamos la expresion como lo hace el parser, y sumamos el largo de sus
+	// alias.
+	size_t largo = alias_n;
+	int subarboles = 0;
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo const* nodo = &expresion->nodos[i];
+		if (nodo->tag == X_NUMERO || nodo->tag == X_ALIAS) {
+			subarboles += 1;
+			if (nodo->tag == X_ALIAS)
+				largo += nodo->valor;
+		}
+		else if (nodo->tag == X_OPERACION && nodo->op < entorno->ops->cantidad &&
+			subarboles >= operador(entorno, nodo)->aridad)
+			subarboles -= operador(entorno, nodo)->aridad - 1;
+		// Si el operador no esta en la tabla o faltan operandos, es invalida.
+		else {
+			subarboles = -1;
+			break;
 		}
 	}
-}
\ No newline at end of file
+	if (subarboles != 1) {
+		expresion_limpiar(expresion);
+		return fallar(error, subarboles ? E_PARSER_EXPRESION : E_PARSER_VACIA);
+	}
+	// Copiamos los textos de los alias en el input de la entrada, para que la
+	// expresion no dependa de la memoria del usuario.
+	char* input = malloc(largo + 1);
+	assert(input);
+	memcpy(input, alias, alias_n);
+	char* it = input + alias_n;
+	for (int i = 0; i < expresion->n; ++i) {
+		Nodo* nodo = &expresion->nodos[i];
+		if (nodo->tag == X_ALIAS) {
+			memcpy(it, nodo->alias, nodo->valor);
+			nodo->alias = it;
+			it += nodo->valor;
+		}
+	}
+	cargar(entorno, input, input, alias_n, expresion, NULL);
+	return 1;
+}
+
+int entorno_evaluar(Entorno* entorno, char const* alias, int* resultado,
+	ErrorTag* error) {
+	presupuesto_renovar(entorno);
+	ErrorTag tag;
+	if (!evaluar_acotado(entorno, alias, strlen(alias), 0, resultado, &tag))
+		return fallar(error, tag);
+	return 1;
+}
+
+void entorno_presupuesto(Entorno* entorno, Presupuesto presupuesto) {
+	entorno->opciones.presupuesto = presupuesto;
+}
+
+int entorno_instantanea(Entorno* entorno) {
+	return instantanea(entorno);
+}
+
+int entorno_restaurar(Entorno* entorno, int numero, ErrorTag* error) {
+	if (!restaurar(entorno, numero))
+		return fallar(error, E_INTERPRETE_INSTANTANEA);
+	return 1;
+}
+
+int entorno_borrar(Entorno* entorno, char const* alias, ErrorTag* error) {
+	if (!borrar(entorno, alias, strlen(alias)))
+		return fallar(error, E_INTERPRETE_ALIAS);
+	return 1;
+}
+
+size_t entorno_memoria(Entorno* entorno) {
+	return memoria(entorno);
+}
+
+int entorno_imprimir(Entorno* entorno, char const* alias, char* buffer,
+	size_t capacidad, ErrorTag* error) {
+	ErrorTag tag;
+	EntradaTablaAlias* entradaAlias =
+		preparar_impresion(entorno, alias, strlen(alias), &tag);
+	if (entradaAlias == NULL)
+		return fallar(error, tag);
+	if (capacidad == 0)
+		return fallar(error, E_INTERPRETE_TAMANO);
+	// Imprimimos en el buffer del usuario, dejando lugar para el '\0'.
+	FILE* salida = fmemopen(buffer, capacidad, "w");
+	assert(salida);
+	setvbuf(salida, NULL, _IONBF, 0);
+	entorno->salida = salida;
+	imprimir_raiz(entorno, expresion_original(entorno, entradaAlias), 0);
+	entorno->salida = NULL;
+	long largo = ftell(salida);
+	fclose(salida);
+	if (largo < 0 || (size_t)largo >= capacidad)
+		return fallar(error, E_INTERPRETE_TAMANO);
+	buffer[largo] = '\0';
+	return 1;
+}
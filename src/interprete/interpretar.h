@@ -2,11 +2,134 @@
 #define INTERPRETAR_H
 
 #include "../tabla_ops.h"
+#include "expresion.h"
+#include "error.h"
+
+#include <stdio.h>
+
+// Presupuesto de evaluacion de cada sentencia: una evaluacion que lo excede se
+// corta con el error E_INTERPRETE_PRESUPUESTO, y la sesion sigue. Un campo en 0
+// no tiene limite. Los limites se controlan cada PRESUPUESTO_CONTROL nodos,
+// por lo que el tiempo puede excederse en lo que tarda ese tramo.
+typedef struct {
+	long long nodos;       // nodos recorridos, al chequear y al evaluar.
+	long long operaciones; // llamadas a operadores.
+	long long milisegundos;
+} Presupuesto;
+
+#define PRESUPUESTO_CONTROL 4096
+
+// Opciones de una sesion del interprete.
+typedef struct {
+	// Si es distinto de 0, al cargar un alias solo se valida su expresion: se
+	// arma recien la primera vez que se usa el alias.
+	int perezoso;
+	// Cantidad de hilos que usa 'evaluar todos'. Con 0 o 1, evalua en el hilo
+	// de la sesion.
+	int hilos;
+	// Presupuesto de 'evaluar', y de las actualizaciones de los observados que
+	// provoca cada sentencia. 'evaluar todos' recorre cada alias una vez, por
+	// lo que no lo usa.
+	Presupuesto presupuesto;
+	// Si no es NULL, ruta del diario de la sesion (ver diario.h): los alias se
+	// recuperan de el al empezar, y cada carga y borrado se agrega al final.
+	char const* diario;
+} OpcionesInterprete;
 
 /**
  * Funcion principal del interprete.
- * Establece una sesion interactiva con el usuario. 
+ * Establece una sesion interactiva con el usuario: lee las sentencias de
+ * 'entrada', una por linea, y escribe las respuestas en 'salida'. La sesion
+ * termina con la sentencia 'salir' o al terminarse la entrada.
+ * Si la entrada empieza con la marca del formato binario (ver binario.h), las
+ * sentencias se decodifican de ese formato en lugar de parsearse.
+ * La tabla de operadores no se modifica, por lo que puede compartirse entre
+ * sesiones que corren en paralelo.
+ * Devuelve 0 si no se pudo abrir o escribir el diario (ver 'diario' en
+ * OpcionesInterprete), y 1 si no.
+ */
+int interpretar(TablaOps* tabla, OpcionesInterprete opciones,
+	FILE* entrada, FILE* salida);
+
+
+// Interfaz para usar el interprete como biblioteca (libinterprete), sin
+// entrada ni salida: cada entorno guarda los alias definidos de una sesion.
+// Las funciones son reentrantes: entornos distintos pueden usarse desde hilos
+// distintos a la vez, compartiendo la tabla de operadores. Las que pueden
+// fallar devuelven 0 y, si 'error' no es NULL, guardan alli la causa.
+typedef struct Entorno Entorno;
+
+/**
+ * Devuelve un entorno sin alias, que usa la tabla de operadores dada. La tabla
+ * debe vivir mientras viva el entorno.
+ */
+Entorno* entorno_nuevo(TablaOps* tabla);
+
+/**
+ * Libera el entorno y todos sus alias.
+ */
+void entorno_destruir(Entorno* entorno);
+
+/**
+ * Define (o redefine) el alias con la expresion postfija dada, como la
+ * sentencia "ALIAS = cargar EXPRESION".
+ */
+int entorno_definir(Entorno* entorno, char const* alias,
+	char const* expresion, ErrorTag* error);
+
+/**
+ * Define (o redefine) el alias con una expresion ya armada con las funciones
+ * de expresion.h, usando operadores de la tabla del entorno. La expresion pasa
+ * a ser del entorno (aun si la definicion falla); los textos de sus alias se
+ * copian.
+ */
+int entorno_definir_expresion(Entorno* entorno, char const* alias,
+	Expresion* expresion, ErrorTag* error);
+
+/**
+ * Establece el presupuesto de cada llamada a 'entorno_evaluar' (al crearse el
+ * entorno, no tiene limites).
+ */
+void entorno_presupuesto(Entorno* entorno, Presupuesto presupuesto);
+
+/**
+ * Evalua el alias y guarda su valor en 'resultado'. Si no puede evaluarse, el
+ * error es E_INTERPRETE_ALIAS (el alias, o uno del que depende, no esta
+ * definido), E_INTERPRETE_CICLO o E_INTERPRETE_PRESUPUESTO.
+ */
+int entorno_evaluar(Entorno* entorno, char const* alias, int* resultado,
+	ErrorTag* error);
+
+/**
+ * Quita el alias del entorno. Su definicion se libera si no esta en ninguna
+ * instantanea.
+ */
+int entorno_borrar(Entorno* entorno, char const* alias, ErrorTag* error);
+
+/**
+ * Devuelve la cantidad de bytes reservados por el entorno, como la sentencia
+ * 'memoria'.
+ */
+size_t entorno_memoria(Entorno* entorno);
+
+/**
+ * Guarda la version actual de los alias del entorno, en O(1). Devuelve el
+ * numero de la instantanea, para 'entorno_restaurar'.
+ */
+int entorno_instantanea(Entorno* entorno);
+
+/**
+ * Vuelve a la version de los alias guardada en la instantanea dada, en O(1).
+ * La instantanea sigue disponible.
+ */
+int entorno_restaurar(Entorno* entorno, int numero, ErrorTag* error);
+
+/**
+ * Escribe la expresion del alias en forma infija en 'buffer', igual que la
+ * sentencia 'imprimir', terminada en '\0'. Falla con E_INTERPRETE_TAMANO si no
+ * entra en 'capacidad' bytes.
  */
-void interpretar(TablaOps* tabla);
+int entorno_imprimir(Entorno* entorno, char const* alias, char* buffer,
+	size_t capacidad, ErrorTag* error);
 
 #endif // INTERPRETAR_H
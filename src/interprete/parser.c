@@ -1,13 +1,21 @@
 #include "parser.h"
 
 #include "../tabla_ops.h"
+#include "../paralelo.h"
 #include "expresion.h"
 
-#include <ctype.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
 
+// Con TOKENIZADOR_ESCALAR, el tokenizador clasifica y convierte de a un
+// caracter, sin SSE2 ni SWAR: 'run_tests.sh' compara ambas versiones.
+#if defined(__SSE2__) && !defined(TOKENIZADOR_ESCALAR)
+#define TOKENIZADOR_SSE2
+#include <emmintrin.h>
+#endif
+
 // En el contexto de un Token, sirve para interpretar la informacion de este
 typedef enum {
 	T_NOMBRE,   // una cadena alfanumrica
@@ -17,7 +25,17 @@ typedef enum {
 	T_EVALUAR,  // 'evaluar'
 	T_CARGAR,   // 'cargar'
 	T_SALIR,    // 'salir'
+	T_OBSERVAR, // 'observar'
+	T_MOSTRAR,  // 'mostrar'
+	T_TODOS,    // 'todos'
+	T_INSTANTANEA, // 'instantanea'
+	T_RESTAURAR,   // 'restaurar'
+	T_BORRAR,   // 'borrar'
+	T_MEMORIA,  // 'memoria'
+	T_ESPECIALIZAR, // 'especializar'
+	T_VARIANDO, // 'variando'
 	T_IGUAL,    // '='
+	T_COMA,     // ','
 	T_FIN,      // el final del string
 	T_INVALIDO, // un error
 } TokenTag;
@@ -38,13 +56,17 @@ typedef struct Tokenizado {
 } Tokenizado;
 
 // Contantes asociadas a las keywords del programa.
-#define CANT_STRINGS_FIJOS 4
+#define CANT_STRINGS_FIJOS 13
 static int const largoStringsFijos[CANT_STRINGS_FIJOS] = 
-	{ 5, 6, 7, 8 };
+	{ 5, 6, 7, 8, 8, 7, 5, 11, 9, 6, 7, 12, 8 };
 static char const* const stringsFijos[CANT_STRINGS_FIJOS] = 
-	{ "salir", "cargar", "evaluar", "imprimir" };
+	{ "salir", "cargar", "evaluar", "imprimir", "observar", "mostrar", "todos",
+	  "instantanea", "restaurar", "borrar", "memoria", "especializar",
+	  "variando" };
 static TokenTag const tokenStringsFijos[CANT_STRINGS_FIJOS] = 
-	{ T_SALIR, T_CARGAR, T_EVALUAR, T_IMPRIMIR };
+	{ T_SALIR, T_CARGAR, T_EVALUAR, T_IMPRIMIR, T_OBSERVAR, T_MOSTRAR, T_TODOS,
+	  T_INSTANTANEA, T_RESTAURAR, T_BORRAR, T_MEMORIA, T_ESPECIALIZAR,
+	  T_VARIANDO };
 
 // Funciones axuliriares para construir una estructura 'Tokenizado'.
 static Tokenizado tokenizado_fin(const char* str) {
@@ -54,6 +76,9 @@ static Tokenizado tokenizado_fin(const char* str) {
 static Tokenizado tokenizado_igual(const char* str) {
 	return (Tokenizado) {str, (Token) {.tag = T_IGUAL}};
 }
+static Tokenizado tokenizado_coma(const char* str) {
+	return (Tokenizado) {str, (Token) {.tag = T_COMA}};
+}
 static Tokenizado tokenizado_str_fijo(const char* str, size_t i) {
 	assert(i <= CANT_STRINGS_FIJOS);
 	return (Tokenizado) {str, (Token){.tag = tokenStringsFijos[i]}};
@@ -65,6 +90,128 @@ static Tokenizado tokenizado_numero(const char* str, int valor) {
 	return (Tokenizado) {str, (Token) {T_NUMERO, 0, valor, 0}};
 }
 
+// Clasificacion de caracteres.
+// No usamos <ctype.h>: sus funciones dependen del locale y no se pueden
+// vectorizar. Estas son equivalentes a las de ctype en el locale "C".
+static inline int es_espacio(char c) {
+	return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
+static inline int es_digito(char c) {
+	return (unsigned char)(c - '0') < 10;
+}
+static inline int es_letra(char c) {
+	return (unsigned char)((c | 0x20) - 'a') < 26;
+}
+static inline int es_caracter_de_nombre(char c) {
+	return es_letra(c) || es_digito(c) || c == '_';
+}
+
+// Clases de caracteres que se pueden saltear de a bloques.
+typedef enum {
+	C_ESPACIO,
+	C_DIGITO,
+	C_NOMBRE,
+} ClaseCaracter;
+
+static inline int en_clase(char c, ClaseCaracter clase) {
+	switch (clase) {
+	case C_ESPACIO: return es_espacio(c);
+	case C_DIGITO:  return es_digito(c);
+	case C_NOMBRE:  return es_caracter_de_nombre(c);
+	}
+	return 0;
+}
+
+#ifdef TOKENIZADOR_SSE2
+// Compara sin signo cada byte: (v - base) < largo.
+static inline __m128i en_rango(__m128i v, char base, char largo) {
+	__m128i const signo = _mm_set1_epi8((char)0x80);
+	__m128i t = _mm_xor_si128(_mm_sub_epi8(v, _mm_set1_epi8(base)), signo);
+	return _mm_cmplt_epi8(t, _mm_xor_si128(_mm_set1_epi8(largo), signo));
+}
+
+// Devuelve una mascara con un bit por byte del bloque, prendido si el byte
+// pertenece a la clase.
+static inline unsigned mascara_clase(__m128i v, ClaseCaracter clase) {
+	__m128i m;
+	switch (clase) {
+	case C_ESPACIO:
+		m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+			en_rango(v, '\t', 5));
+		break;
+	case C_DIGITO:
+		m = en_rango(v, '0', 10);
+		break;
+	default: // C_NOMBRE
+		m = _mm_or_si128(
+			_mm_or_si128(en_rango(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 26),
+				en_rango(v, '0', 10)),
+			_mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+		break;
+	}
+	return (unsigned)_mm_movemask_epi8(m);
+}
+#endif
+
+// Devuelve la cantidad de caracteres consecutivos de la clase dada al
+// principio del string. El '\0' final no pertenece a ninguna clase.
+//
+// Los dos primeros caracteres se miran de a uno, ya que la mayoria de los
+// tokens y separadores son cortos. A partir de ahi se procesan bloques de 16
+// bytes alineados: un bloque alineado nunca cruza un limite de pagina, por lo
+// que leer mas alla del '\0' es seguro aunque el string termine antes. Como
+// AddressSanitizer no lo sabe, excluimos la funcion de sus chequeos.
+#if defined(__GNUC__)
+__attribute__((no_sanitize_address))
+#endif
+static int largo_de_clase(char const* str, ClaseCaracter clase) {
+	if (!en_clase(str[0], clase)) return 0;
+	if (!en_clase(str[1], clase)) return 1;
+#ifdef TOKENIZADOR_SSE2
+	char const* inicio = str;
+	uintptr_t desfase = (uintptr_t)str & 15;
+	char const* bloque = str - desfase;
+	// Ignoramos los bytes del primer bloque que estan antes del string.
+	unsigned fuera = (1u << desfase) - 1;
+	unsigned mascara = 
+		mascara_clase(_mm_load_si128((__m128i const*)bloque), clase) | fuera;
+	while (mascara == 0xFFFF) {
+		bloque += 16;
+		mascara = mascara_clase(_mm_load_si128((__m128i const*)bloque), clase);
+	}
+	// El primer bit apagado marca el primer caracter fuera de la clase.
+	return (bloque - inicio) + __builtin_ctz(~mascara);
+#else
+	int largo = 2;
+	while (en_clase(str[largo], clase))
+		largo += 1;
+	return largo;
+#endif
+}
+
+// Convierte los digitos del string a un numero. Los desbordes se comportan
+// como en la aritmetica modulo 2^32.
+// Con SWAR (SIMD within a register) se convierten 8 digitos por vez: se
+// combinan de a pares, luego de a cuatro, y luego de a ocho.
+static int convertir_digitos(char const* str, int largo) {
+	uint32_t valor = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && \
+	!defined(TOKENIZADOR_ESCALAR)
+	for (; largo >= 8; str += 8, largo -= 8) {
+		uint64_t x;
+		memcpy(&x, str, 8);
+		x -= 0x3030303030303030ull;
+		x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFull;
+		x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFull;
+		x = (x * 10000 + (x >> 32)) & 0xFFFFFFFFull;
+		valor = valor * 100000000u + (uint32_t)x;
+	}
+#endif
+	for (int i = 0; i < largo; ++i)
+		valor = valor * 10 + (uint32_t)(str[i] - '0');
+	return (int)valor;
+}
+
 // Analiza el pricipio del string, y extrae una pieza, dandole sentido.
 // Luego, devuelve una representacion de esa pieza, y un puntero a donde esa
 // pieza termina, y empieza el resto del string.
@@ -75,8 +222,7 @@ static Tokenizado tokenizado_numero(const char* str, int valor) {
 static Tokenizado tokenizar(char const* str, TablaOps* tablaOps) {
 
 	// Descartamos espacio en blanco.
-	while (isspace(*str))
-		str += 1;
+	str += largo_de_clase(str, C_ESPACIO);
 
 	// LLegamos al fin de la linea.
 	if (*str == '\0')
@@ -86,7 +232,8 @@ static Tokenizado tokenizar(char const* str, TablaOps* tablaOps) {
 	EntradaTablaOps* opQueMatchea = NULL;
 	int largoOpQueMatchea = 0;
 	// Buscamos el operador en la tabla de operaciones.
-	for (EntradaTablaOps* it = tablaOps->entradas; it; it = it->sig) {
+	for (int j = 0; j < tablaOps->cantidad; ++j) {
+		EntradaTablaOps* it = &tablaOps->entradas[j];
 		int largoOp = strlen(it->simbolo);
 
 		if (largoOp < largoOpQueMatchea)
@@ -106,7 +253,7 @@ static Tokenizado tokenizar(char const* str, TablaOps* tablaOps) {
 		}
 	}
 
-	if (opQueMatchea != NULL && !isalpha(str[largoOpQueMatchea]))
+	if (opQueMatchea != NULL && !es_letra(str[largoOpQueMatchea]))
 		return (Tokenizado){
 			str + largoOpQueMatchea,
 			(Token){T_OPERADOR, NULL, 0, opQueMatchea}};
@@ -115,11 +262,13 @@ static Tokenizado tokenizar(char const* str, TablaOps* tablaOps) {
 	if (*str == '=')
 		return tokenizado_igual(str + 1);
 
+	// Identificamos una coma.
+	if (*str == ',')
+		return tokenizado_coma(str + 1);
+
 	// Reconocemos un nombre.
-	if (isalpha(str[0]) || (str[0] == '_')) {
-		int largo = 1;
-		while (isalnum(str[largo]) || (str[largo] == '_'))
-			largo += 1;
+	if (es_letra(str[0]) || (str[0] == '_')) {
+		int largo = largo_de_clase(str, C_NOMBRE);
 		
 		// Chequeamos si la palabra es una keyword (cargar, salir, etc.). 
 		for (size_t i = 0; i < CANT_STRINGS_FIJOS; ++i)
@@ -132,15 +281,9 @@ static Tokenizado tokenizar(char const* str, TablaOps* tablaOps) {
 	}
 
 	// Reconocemos un numero.
-	if (isdigit(str[0])) {
-		int valor = str[0] - '0';
-		int largo = 1;
-		while (isdigit(str[largo])) {
-			valor = (valor * 10) + (str[largo] - '0');
-			largo += 1;
-		}
-
-		return tokenizado_numero(str + largo, valor);
+	if (es_digito(str[0])) {
+		int largo = largo_de_clase(str, C_DIGITO);
+		return tokenizado_numero(str + largo, convertir_digitos(str, largo));
 	}
 
 	// No hay coincidencias: el token es invalido.
@@ -148,57 +291,6 @@ static Tokenizado tokenizar(char const* str, TablaOps* tablaOps) {
 }
 
 
-// Usamos esta pila para armar un arbol de expresiones a partir de la expresion
-// postifja.
-typedef struct EntradaPilaDeExpresiones EntradaPilaDeExpresiones;
-struct EntradaPilaDeExpresiones {
-	EntradaPilaDeExpresiones* sig;
-	Expresion* expresion;
-};
-
-typedef struct PilaDeExpresiones {
-	EntradaPilaDeExpresiones* entradas;
-} PilaDeExpresiones;
-
-// Inserta una expresion en el tope de la pila.
-static void pila_de_expresiones_push(PilaDeExpresiones* pila, 
-	Expresion* expresion) {
-	EntradaPilaDeExpresiones* entrada = malloc(sizeof(*entrada));
-	*entrada = (EntradaPilaDeExpresiones){
-		.sig = pila->entradas,
-		.expresion = expresion
-	};
-	pila->entradas = entrada;
-}
-
-// Remueve un elemento del tope de la pila y lo devuelve.
-static Expresion* pila_de_expresiones_pop(PilaDeExpresiones* pila) {
-	if (pila->entradas == NULL) return NULL;
-	Expresion* result = pila->entradas->expresion;
-	EntradaPilaDeExpresiones* entrada = pila->entradas;
-	pila->entradas = entrada->sig;
-	free(entrada);
-	return result;
-}
-
-// Devuelve el elemento tope de la pila.
-static Expresion* pila_de_expresiones_top(PilaDeExpresiones* pila) {
-	if (pila->entradas == NULL)
-		return NULL;
-	return pila->entradas->expresion;
-}
-
-// Libera el espacio de memoria ocupado por la pila.
-static void pila_de_expresiones_limpiar_datos(PilaDeExpresiones* pila) {
-	EntradaPilaDeExpresiones* it = pila->entradas;
-	while (it) {
-		EntradaPilaDeExpresiones* sig = it->sig;
-		expresion_limpiar(it->expresion);
-		free(it);
-		it = sig;
-	}
-}
-
 // Funciones auxiliares para construir una estructura 'Parseado'.
 static Parseado parseado_invalido(char const* str, ErrorTag error) {
 	return (Parseado){str, (Sentencia){.tag = S_INVALIDO}, error};
@@ -208,22 +300,403 @@ static Parseado parseado_salir(const char* str) {
 }
 static Parseado parseado_evaluar(const char* str, const char* alias,
 	int alias_n) {
-	return (Parseado) {str, (Sentencia) {S_EVALUAR, alias, alias_n, 0}, 0};
+	return (Parseado){str, 
+		(Sentencia){.tag = S_EVALUAR, .alias = alias, .alias_n = alias_n}, 0};
 	}
+static Parseado parseado_evaluar_todos(const char* str) {
+	return (Parseado){str, (Sentencia){.tag = S_EVALUAR_TODOS}, 0};
+}
+static Parseado parseado_instantanea(const char* str) {
+	return (Parseado){str, (Sentencia){.tag = S_INSTANTANEA}, 0};
+}
+static Parseado parseado_restaurar(const char* str, int numero) {
+	return (Parseado){str, (Sentencia){.tag = S_RESTAURAR, .numero = numero}, 0};
+}
+static Parseado parseado_borrar(const char* str, const char* alias,
+	int alias_n) {
+	return (Parseado){str, 
+		(Sentencia){.tag = S_BORRAR, .alias = alias, .alias_n = alias_n}, 0};
+}
+static Parseado parseado_memoria(const char* str) {
+	return (Parseado){str, (Sentencia){.tag = S_MEMORIA}, 0};
+}
+static Parseado parseado_especializar(const char* str, const char* alias,
+	int alias_n, Expresion* variables) {
+	return (Parseado){str, (Sentencia){
+		.tag = S_ESPECIALIZAR,
+		.alias = alias,
+		.alias_n = alias_n,
+		.expresion = variables,
+	}, 0};
+}
 static Parseado parseado_imprimir(const char* str, const char* alias, 
 	int alias_n) {
-	return (Parseado) {str, (Sentencia) {S_IMPRIMIR, alias, alias_n, 0}, 0}; 
+	return (Parseado){str, 
+		(Sentencia){.tag = S_IMPRIMIR, .alias = alias, .alias_n = alias_n}, 0};
+}
+static Parseado parseado_observar(const char* str, const char* alias, 
+	int alias_n) {
+	return (Parseado){str, 
+		(Sentencia){.tag = S_OBSERVAR, .alias = alias, .alias_n = alias_n}, 0};
+}
+static Parseado parseado_mostrar(const char* str, const char* alias, 
+	int alias_n) {
+	return (Parseado){str, 
+		(Sentencia){.tag = S_MOSTRAR, .alias = alias, .alias_n = alias_n}, 0};
 }
 static Parseado parseado_cargar(
 	const char* str,
 	const char* alias,
 	int alias_n,
-	Expresion* expresion) {
-	return (Parseado){str, (Sentencia){S_CARGA, alias, alias_n, expresion}, 0};
+	Expresion* expresion,
+	const char* fuente) {
+	return (Parseado){str, (Sentencia){
+		.tag = S_CARGA,
+		.alias = alias,
+		.alias_n = alias_n,
+		.expresion = expresion,
+		.fuente = fuente,
+	}, 0};
+	}
+
+// Analiza una expresion postfija, hasta el final del string.
+// Si 'expresion' no es NULL, arma en ella la expresion: si *expresion ya es una
+// expresion (un borrador), se vacia y se reutiliza; si es NULL, se crea. Si
+// 'expresion' es NULL, solo la valida: no reserva memoria.
+// Devuelve 0 si la expresion es invalida, y guarda el error en 'error' (la
+// expresion creada se libera; el borrador no).
+// Siempre avanza 'str' hasta donde llego el analisis.
+//
+// Los nodos de la expresion se guardan en el mismo orden postfijo en que
+// se ingresan, por lo que no hace falta armar el arbol con una pila: 
+// alcanza con llevar la cuenta de cuantos subarboles completos hay.
+// Los valores sueltos, como numeros y aliases, agregan un subarbol.
+// Al encontrar un operador, este toma tantos subarboles como sea su
+// aridad, y los reemplaza por el subarbol que representa la aplicacion
+// del operador a sus operandos.
+static int parsear_postfija(char const** str, TablaOps* tablaOps, 
+	Expresion** expresion, ErrorTag* error) {
+	int creada = expresion && *expresion == NULL;
+	if (creada)
+		*expresion = expresion_crear(16);
+	else if (expresion)
+		(*expresion)->n = 0;
+	int subarboles = 0;
+	// parseo y, mientras, voy validando
+	while (1) {
+		Tokenizado tokenizado = tokenizar(*str, tablaOps);
+		*str = tokenizado.resto;
+		Token token = tokenizado.token;
+
+		if (token.tag == T_FIN)
+			break;
+
+		switch (token.tag) {
+		case T_NUMERO:
+			if (expresion)
+				expresion_numero(expresion, token.valor);
+			subarboles += 1;
+			break;
+		case T_NOMBRE:
+			if (expresion)
+				expresion_alias(expresion, token.inicio, token.valor);
+			subarboles += 1;
+			break;
+		case T_OPERADOR:
+			// Si faltan operandos, la expresion es invalida.
+			if (subarboles < token.op->aridad) {
+				*error = E_PARSER_EXPRESION;
+				goto fallo;
+			}
+			if (expresion)
+				expresion_operacion(expresion, token.op);
+			subarboles -= token.op->aridad - 1;
+			break;
+
+		// No reconocimos numero, operacion o alias.
+		default:
+			*error = E_PARSER_EXPRESION;
+			goto fallo;
+		}
+	}
+
+	// Si no se ingreso ninguna expresion, informamos el error.
+	if (subarboles == 0) {
+		*error = E_PARSER_VACIA;
+		goto fallo;
+	}
+	// Si sobran subarboles, la expresion es invalida.
+	if (subarboles > 1) {
+		*error = E_PARSER_EXPRESION;
+		goto fallo;
+	}
+	return 1;
+
+	fallo:
+	if (creada) {
+		expresion_limpiar(*expresion);
+		*expresion = NULL;
+	}
+	return 0;
+}
+
+// Analisis en paralelo de expresiones largas.
+//
+// El string se parte en tramos que empiezan despues de un espacio, y cada uno
+// se tokeniza y se arma por separado. Como ningun token contiene espacios, los
+// tokens de los tramos son los mismos que los del string entero, y como los
+// nodos se guardan en el orden en que se ingresan, los de cada tramo ocupan
+// un rango contiguo de la expresion. Lo unico que un tramo no puede resolver
+// solo es donde empiezan las operaciones cuyos operandos estan en tramos
+// anteriores.
+//
+// Para eso, cada tramo lleva una pila con el comienzo de sus subarboles
+// completos. Cuando una operacion necesita mas operandos que los de la pila,
+// los toma de la pila de entrada (la que dejan los tramos anteriores), que
+// todavia no se conoce: se anota la profundidad del operando en ella. Luego,
+// una pasada secuencial sobre las pilas calcula la pila de entrada de cada
+// tramo, y una pasada en paralelo copia los nodos a la expresion, resolviendo
+// los comienzos pendientes.
+
+// Largo minimo de un string para analizarlo en paralelo, y de cada tramo.
+#define PARALELO_MINIMO (1 << 20)
+#define PARALELO_TRAMO (1 << 18)
+
+typedef struct {
+	char const* inicio;
+	char const* fin; // el primer caracter del tramo siguiente.
+	// Los nodos del tramo. El comienzo de una operacion es un indice dentro
+	// del tramo, o -(d + 1) si es el del operando de profundidad d en la pila
+	// de entrada.
+	Expresion* nodos;
+	// Comienzo de los subarboles completos del tramo, con la misma notacion.
+	int* pila;
+	int tope;
+	int capacidad;
+	int consumidos; // cantidad de operandos tomados de la pila de entrada.
+	int valido;
+	// Posicion del primer nodo en la expresion, y comienzo de los operandos
+	// que toma de la pila de entrada (desde el tope).
+	int base;
+	int* entrada;
+} Tramo;
+
+typedef struct {
+	TablaOps* tablaOps;
+	Tramo* tramos;
+	Expresion* expresion;
+} AnalisisParalelo;
+
+static void tramo_apilar(Tramo* tramo, int inicio) {
+	if (tramo->tope == tramo->capacidad) {
+		tramo->capacidad = tramo->capacidad ? 2 * tramo->capacidad : 64;
+		tramo->pila = realloc(tramo->pila, tramo->capacidad * sizeof(int));
+		assert(tramo->pila);
+	}
+	tramo->pila[tramo->tope++] = inicio;
+}
+
+// Tokeniza y arma el i-esimo tramo. Ante cualquier token invalido, marca el
+// tramo como invalido y deja que el analisis secuencial informe el error.
+static void tramo_analizar(void* analisis_, int i) {
+	AnalisisParalelo* analisis = analisis_;
+	Tramo* tramo = &analisis->tramos[i];
+	char const* str = tramo->inicio;
+	// Cada token ocupa al menos dos caracteres, contando su separador.
+	tramo->nodos = expresion_crear((tramo->fin - tramo->inicio) / 4);
+	tramo->valido = 1;
+	while (1) {
+		// Los espacios se saltean aca, para no pasar al tramo siguiente.
+		str += largo_de_clase(str, C_ESPACIO);
+		if (str >= tramo->fin)
+			return;
+		Tokenizado tokenizado = tokenizar(str, analisis->tablaOps);
+		str = tokenizado.resto;
+		Token token = tokenizado.token;
+		switch (token.tag) {
+		case T_NUMERO:
+			expresion_numero(&tramo->nodos, token.valor);
+			tramo_apilar(tramo, tramo->nodos->n - 1);
+			break;
+		case T_NOMBRE:
+			expresion_alias(&tramo->nodos, token.inicio, token.valor);
+			tramo_apilar(tramo, tramo->nodos->n - 1);
+			break;
+		case T_OPERADOR: {
+			// La operacion empieza donde empieza su primer operando.
+			int aridad = token.op->aridad;
+			int inicio;
+			if (tramo->tope >= aridad) {
+				tramo->tope -= aridad;
+				inicio = tramo->pila[tramo->tope];
+			}
+			else {
+				tramo->consumidos += aridad - tramo->tope;
+				tramo->tope = 0;
+				inicio = -tramo->consumidos;
+			}
+			expresion_agregar(&tramo->nodos, (Nodo){
+				.tag = X_OPERACION,
+				.op = token.op->id,
+				.valor = inicio,
+			});
+			tramo_apilar(tramo, inicio);
+		} break;
+		default:
+			tramo->valido = 0;
+			return;
+		}
+	}
+}
+
+// Copia los nodos del i-esimo tramo a la expresion, resolviendo los
+// comienzos de sus operaciones.
+static void tramo_copiar(void* analisis_, int i) {
+	AnalisisParalelo* analisis = analisis_;
+	Tramo* tramo = &analisis->tramos[i];
+	Nodo* destino = &analisis->expresion->nodos[tramo->base];
+	for (int k = 0; k < tramo->nodos->n; ++k) {
+		Nodo nodo = tramo->nodos->nodos[k];
+		if (nodo.tag == X_OPERACION)
+			nodo.valor = nodo.valor >= 0 ?
+				tramo->base + nodo.valor : tramo->entrada[-nodo.valor - 1];
+		destino[k] = nodo;
+	}
+}
+
+// Calcula la pila de entrada de cada tramo, y la posicion de sus nodos en la
+// expresion. Devuelve la cantidad total de nodos, o -1 si algun tramo es
+// invalido o la expresion no queda como un unico subarbol.
+static int unir_tramos(Tramo* tramos, int cantidad) {
+	// La pila de la expresion hasta el tramo actual, con comienzos globales.
+	int* pila = NULL;
+	int tope = 0;
+	int capacidad = 0;
+	int base = 0;
+	for (int t = 0; t < cantidad; ++t) {
+		Tramo* tramo = &tramos[t];
+		if (!tramo->valido || tramo->consumidos > tope ||
+			tramo->nodos->n > INT32_MAX - base) {
+			base = -1;
+			break;
+		}
+		tramo->base = base;
+		tramo->entrada = malloc((tramo->consumidos + 1) * sizeof(int));
+		assert(tramo->entrada);
+		for (int d = 0; d < tramo->consumidos; ++d)
+			tramo->entrada[d] = pila[tope - 1 - d];
+		tope -= tramo->consumidos;
+		if (tope + tramo->tope > capacidad) {
+			capacidad = 2 * (tope + tramo->tope);
+			pila = realloc(pila, capacidad * sizeof(int));
+			assert(pila);
+		}
+		for (int k = 0; k < tramo->tope; ++k) {
+			int inicio = tramo->pila[k];
+			pila[tope++] = inicio >= 0 ? base + inicio : tramo->entrada[-inicio - 1];
+		}
+		base += tramo->nodos->n;
+	}
+	free(pila);
+	return tope == 1 ? base : -1;
+}
+
+// Arma la expresion postfija que ocupa el resto del string en paralelo, con
+// el mismo resultado que 'parsear_postfija'. Devuelve NULL si el string es
+// corto, o si la expresion es invalida (el error lo informa el analisis
+// secuencial).
+static Expresion* parsear_paralelo(char const* str, TablaOps* tablaOps,
+	int hilos) {
+	size_t largo = strlen(str);
+	if (largo < PARALELO_MINIMO)
+		return NULL;
+	// Un operador con espacios podria cruzar el limite entre dos tramos.
+	for (int j = 0; j < tablaOps->cantidad; ++j)
+		for (char const* c = tablaOps->entradas[j].simbolo; *c; ++c)
+			if (es_espacio(*c))
+				return NULL;
+
+	// Partimos el string en tramos de largos parecidos, varios por hilo para
+	// repartir mejor la carga.
+	int cantidad = 4 * hilos;
+	if ((size_t)cantidad > largo / PARALELO_TRAMO)
+		cantidad = largo / PARALELO_TRAMO;
+	Tramo* tramos = calloc(cantidad, sizeof(Tramo));
+	assert(tramos);
+	char const* fin = str + largo;
+	char const* inicio = str;
+	for (int t = 0; t < cantidad; ++t) {
+		char const* corte = t + 1 < cantidad ?
+			str + largo / cantidad * (t + 1) : fin;
+		if (corte < inicio)
+			corte = inicio;
+		// Cortamos despues del siguiente espacio.
+		while (corte < fin && !es_espacio(*corte))
+			corte += 1;
+		corte += largo_de_clase(corte, C_ESPACIO);
+		tramos[t].inicio = inicio;
+		tramos[t].fin = corte;
+		inicio = corte;
+	}
+
+	AnalisisParalelo analisis = { .tablaOps = tablaOps, .tramos = tramos };
+	paralelo_para(hilos, cantidad, tramo_analizar, &analisis);
+	int n = unir_tramos(tramos, cantidad);
+	if (n > 0) {
+		analisis.expresion = expresion_crear(n);
+		analisis.expresion->n = n;
+		paralelo_para(hilos, cantidad, tramo_copiar, &analisis);
+	}
+
+	for (int t = 0; t < cantidad; ++t) {
+		expresion_limpiar(tramos[t].nodos);
+		free(tramos[t].pila);
+		free(tramos[t].entrada);
 	}
+	free(tramos);
+	return analisis.expresion;
+}
+
+Expresion* parsear_expresion(char const* str, TablaOps* tablaOps) {
+	Expresion* expresion = NULL;
+	ErrorTag error;
+	int esValida = parsear_postfija(&str, tablaOps, &expresion, &error);
+	assert(esValida);
+	(void)esValida;
+	return expresion;
+}
+
+int validar_expresion(char const* str, TablaOps* tablaOps, ErrorTag* error) {
+	return parsear_postfija(&str, tablaOps, NULL, error);
+}
 
 
-Parseado parsear(char const* str, TablaOps* tablaOps) {
+int parsear_alias(char const* str, TablaOps* tablaOps) {
+	Tokenizado tokenizado = tokenizar(str, tablaOps);
+	// El nombre debe ocupar todo el string.
+	if (tokenizado.token.tag != T_NOMBRE || tokenizado.token.inicio != str ||
+		tokenizado.resto[0] != '\0')
+		return 0;
+	return tokenizado.token.valor;
+}
+
+// Capacidad (en nodos) a partir de la cual el borrador de 'parsear' se libera
+// despues de usarse, para no retener la memoria de una expresion enorme.
+#define BORRADOR_MAXIMO (1 << 16)
+
+// Devuelve una copia del borrador de su tamano justo, y libera el borrador si
+// quedo mas grande que BORRADOR_MAXIMO.
+static Expresion* copiar_borrador(Expresion** borrador) {
+	Expresion* copia = expresion_copiar(*borrador);
+	if ((*borrador)->capacidad > BORRADOR_MAXIMO) {
+		expresion_limpiar(*borrador);
+		*borrador = NULL;
+	}
+	return copia;
+}
+
+Parseado parsear(char const* str, TablaOps* tablaOps, int perezoso,
+	int hilos, Expresion** borrador) {
 	// Obtenemos el primer token del input.
 	Tokenizado tokenizado = tokenizar(str, tablaOps);
 	str = tokenizado.resto;
@@ -238,6 +711,9 @@ Parseado parsear(char const* str, TablaOps* tablaOps) {
 	case T_EVALUAR:
 		tokenizado = tokenizar(str, tablaOps);
 		str = tokenizado.resto;
+		// 'evaluar todos' evalua todos los alias.
+		if (tokenizado.token.tag == T_TODOS)
+			return parseado_evaluar_todos(str);
 		// Si no se ingreso un alias, el input es invalido.
 		if (tokenizado.token.tag != T_NOMBRE)
 			return parseado_invalido(str, E_PARSER_ALIAS);
@@ -256,6 +732,104 @@ Parseado parsear(char const* str, TablaOps* tablaOps) {
 			parseado_imprimir(str, tokenizado.token.inicio, tokenizado.token.valor);
 		break;
 
+	// observar
+	case T_OBSERVAR:
+		tokenizado = tokenizar(str, tablaOps);
+		str = tokenizado.resto;
+		// Si no se ingreso un alias, el input es invalido.
+		if (tokenizado.token.tag != T_NOMBRE)
+			return parseado_invalido(str, E_PARSER_ALIAS);
+		return 
+			parseado_observar(str, tokenizado.token.inicio, tokenizado.token.valor);
+		break;
+
+	// mostrar
+	case T_MOSTRAR:
+		tokenizado = tokenizar(str, tablaOps);
+		str = tokenizado.resto;
+		// Si no se ingreso un alias, el input es invalido.
+		if (tokenizado.token.tag != T_NOMBRE)
+			return parseado_invalido(str, E_PARSER_ALIAS);
+		return 
+			parseado_mostrar(str, tokenizado.token.inicio, tokenizado.token.valor);
+		break;
+
+	// instantanea
+	case T_INSTANTANEA:
+		return parseado_instantanea(str);
+		break;
+
+	// restaurar
+	case T_RESTAURAR:
+		tokenizado = tokenizar(str, tablaOps);
+		str = tokenizado.resto;
+		// Si no se ingreso el numero de instantanea, el input es invalido.
+		if (tokenizado.token.tag != T_NUMERO)
+			return parseado_invalido(str, E_PARSER_NUMERO);
+		return parseado_restaurar(str, tokenizado.token.valor);
+		break;
+
+	// borrar
+	case T_BORRAR:
+		tokenizado = tokenizar(str, tablaOps);
+		str = tokenizado.resto;
+		// Si no se ingreso un alias, el input es invalido.
+		if (tokenizado.token.tag != T_NOMBRE)
+			return parseado_invalido(str, E_PARSER_ALIAS);
+		return 
+			parseado_borrar(str, tokenizado.token.inicio, tokenizado.token.valor);
+		break;
+
+	// memoria
+	case T_MEMORIA:
+		return parseado_memoria(str);
+		break;
+
+	// especializar
+	case T_ESPECIALIZAR: {
+		tokenizado = tokenizar(str, tablaOps);
+		str = tokenizado.resto;
+		// Si no se ingreso un alias, el input es invalido.
+		if (tokenizado.token.tag != T_NOMBRE)
+			return parseado_invalido(str, E_PARSER_ALIAS);
+		char const* alias = tokenizado.token.inicio;
+		int alias_n = tokenizado.token.valor;
+
+		// Chequeamos que se haya ingresado la keyword 'variando'.
+		tokenizado = tokenizar(str, tablaOps);
+		str = tokenizado.resto;
+		if (tokenizado.token.tag != T_VARIANDO)
+			return parseado_invalido(str, E_PARSER_VARIANDO);
+
+		// Leemos los alias variables, separados por comas (en el borrador, de
+		// haberlo).
+		Expresion* variables = NULL;
+		Expresion** destino = borrador ? borrador : &variables;
+		if (*destino == NULL)
+			*destino = expresion_crear(4);
+		else
+			(*destino)->n = 0;
+		int esValida;
+		do {
+			tokenizado = tokenizar(str, tablaOps);
+			str = tokenizado.resto;
+			esValida = tokenizado.token.tag == T_NOMBRE;
+			if (!esValida)
+				break;
+			expresion_alias(destino, tokenizado.token.inicio,
+				tokenizado.token.valor);
+			tokenizado = tokenizar(str, tablaOps);
+			str = tokenizado.resto;
+		} while (tokenizado.token.tag == T_COMA);
+		if (!esValida || tokenizado.token.tag != T_FIN) {
+			expresion_limpiar(variables);
+			return parseado_invalido(str, E_PARSER_ALIAS);
+		}
+		if (borrador)
+			variables = copiar_borrador(borrador);
+		return parseado_especializar(str, alias, alias_n, variables);
+		} break;
+
 	// alias
 	case T_NOMBRE: {
 		char const* alias = tokenizado.token.inicio;
@@ -274,76 +848,22 @@ Parseado parsear(char const* str, TablaOps* tablaOps) {
 		if (tokenizado.token.tag != T_CARGAR)
 			return parseado_invalido(str, E_PARSER_CARGA);
 
-		// Convierto expresion postfija a infija, usando una pila:
-		// Los valores sueltos, como numeros y aliases, los inserto en la pila.
-		// Al encontrar un operador, extraigo tantas expresiones de la pila como
-		// sea la aridad del operador, y creo la expresion que representa la
-		// aplicacion del operador a sus operandos. Finalmente, inserto esa
-		// expresion en la pila.
-
-		// {} inicializa con 0s, lo cual es el estado inicial correcto
-		PilaDeExpresiones p = {};
-		// parseo y, mientras, voy validando
-		while (1) {
-			tokenizado = tokenizar(str, tablaOps);
-			str = tokenizado.resto;
-			Token token = tokenizado.token;
-
-			if (token.tag == T_FIN)
-				break;
-
-			switch (token.tag) {
-			case T_NUMERO: {
-				pila_de_expresiones_push(&p, expresion_numero(token.valor));
-				} break;
-			case T_NOMBRE: {
-				pila_de_expresiones_push(&p, expresion_alias(token.inicio, token.valor));
-				} break;
-			case T_OPERADOR: {
-				Expresion* arg1 = pila_de_expresiones_pop(&p);
-				if (arg1 == NULL)
-					goto fail_arg1;
-
-				Expresion* arg2 = NULL;
-				if (token.op->aridad == 2) {
-					arg2 = pila_de_expresiones_pop(&p);
-					if (arg2 == NULL)
-						goto fail_arg2;
-				}
-
-				pila_de_expresiones_push(&p, expresion_operacion(token.op, arg1, arg2));
-				break;
-
-				// Si el arg2 es invalido, debemos limpiar el arg1 primero.
-				fail_arg2:
-				expresion_limpiar(arg1);
-
-				fail_arg1:
-				pila_de_expresiones_limpiar_datos(&p);
-				return parseado_invalido(str, E_PARSER_EXPRESION);
-
-				} break;
-
-			// No reconocimos numero, operacion o alias.
-			default:
-				pila_de_expresiones_limpiar_datos(&p);
-				return parseado_invalido(str, E_PARSER_EXPRESION);
-			}
-		}
-
-		// Obtenemos la expresion final de la pila.
-		Expresion* expresion = pila_de_expresiones_pop(&p);
-
-		// Si no se ingreso ninguna expresion, informamos el error.
-		if (expresion == NULL) return parseado_invalido(str, E_PARSER_VACIA);
-		// Si hay elementos de mas en la pila, la expresion es invalida.
-		if (pila_de_expresiones_top(&p) != NULL) {
-			expresion_limpiar(expresion);
-			pila_de_expresiones_limpiar_datos(&p);
-			return parseado_invalido(str, E_PARSER_EXPRESION);
-		}
+		// Si se pide, solo validamos la expresion, sin armarla. Si no, las
+		// expresiones largas se intentan armar en paralelo, y el resto se arma
+		// en el borrador (de haberlo).
+		char const* fuente = str;
+		ErrorTag error;
+		Expresion* expresion = NULL;
+		Expresion** destino = perezoso ? NULL : borrador ? borrador : &expresion;
+		if (!perezoso && hilos > 1 &&
+			(expresion = parsear_paralelo(str, tablaOps, hilos)) != NULL)
+			str += strlen(str);
+		else if (!parsear_postfija(&str, tablaOps, destino, &error))
+			return parseado_invalido(str, error);
+		else if (destino == borrador)
+			expresion = copiar_borrador(borrador);
 		// En caso de estar todo ok, devolvemos la sentencia apropiada.
-		return parseado_cargar(str, alias, alias_n, expresion);
+		return parseado_cargar(str, alias, alias_n, expresion, fuente);
 		} break;
 	
 	case T_OPERADOR:
@@ -11,6 +11,14 @@ typedef enum {
 	S_CARGA,    // ALIAS = cargar EXPR
 	S_IMPRIMIR, // imprimir ALIAS
 	S_EVALUAR,  // evaluar ALIAS
+	S_EVALUAR_TODOS, // evaluar todos
+	S_OBSERVAR, // observar ALIAS
+	S_MOSTRAR,  // mostrar ALIAS
+	S_INSTANTANEA, // instantanea
+	S_RESTAURAR,   // restaurar N
+	S_BORRAR,   // borrar ALIAS
+	S_MEMORIA,  // memoria
+	S_ESPECIALIZAR, // especializar ALIAS variando ALIAS, ALIAS, ...
 	S_SALIR,    // salir
 	S_INVALIDO, // (un error)
 } SentenciaTag;
@@ -21,7 +29,13 @@ typedef struct Sentencia {
 	SentenciaTag tag;
 	char const* alias;    // alias
 	int alias_n;          // largo del alias
-	Expresion* expresion; // expresion matematica ingresada.
+	Expresion* expresion; // expresion matematica ingresada (en S_CARGA), o los
+	                      // alias variables, como nodos sueltos (en
+	                      // S_ESPECIALIZAR).
+	// texto de la expresion ingresada (en S_CARGA), que va hasta el final de la
+	// linea.
+	char const* fuente;
+	int numero;           // numero de instantanea (en S_RESTAURAR).
 } Sentencia;
 
 typedef struct {
@@ -33,13 +47,47 @@ typedef struct {
 /** Analiza el principio del string, y reconoce la primera accion que debe tomar
  * el interprete. Luego, devuelve una representacion de ella, junto a un puntero
  * al resto del string, que todavia no fue analizado.
+ * Si 'perezoso' es distinto de 0, la expresion de una carga solo se valida: no
+ * se arma (sentencia.expresion queda en NULL), y se puede armar mas tarde a
+ * partir de sentencia.fuente con 'parsear_expresion'.
+ * Si 'hilos' es mayor a 1, las expresiones de mas de un MiB se tokenizan y se
+ * arman de a tramos, en paralelo. La expresion resultante es la misma.
+ * Si 'borrador' no es NULL, las expresiones se arman en *borrador (que se crea
+ * si es NULL, y se reutiliza entre llamadas), y la sentencia se queda con una
+ * copia de su tamano justo: asi, una sentencia invalida no reserva memoria. El
+ * borrador se debe limpiar con 'expresion_limpiar' (si no es NULL).
  **
  * # uso de memoria:
  * argumentos: No limpia nada;
  * resultado: depende de sentencia.tag:
- *  -si es S_CARGA, se debe limpiar la sentencia.expresion
+ *  -si es S_CARGA o S_ESPECIALIZAR, se debe limpiar la sentencia.expresion
  *  -En el resto de los casos, nada se debe limpiar.
  */
-Parseado parsear(char const* str, TablaOps* tabla_ops);
+Parseado parsear(char const* str, TablaOps* tabla_ops, int perezoso,
+	int hilos, Expresion** borrador);
+
+/**
+ * Arma la expresion postfija que ocupa el resto del string, que ya debe haber
+ * sido validada por 'parsear' (es decir, debe ser la sentencia.fuente de una
+ * carga).
+ **
+ * # uso de memoria:
+ * argumentos: No limpia nada;
+ * resultado: se debe limpiar la expresion.
+ */
+Expresion* parsear_expresion(char const* str, TablaOps* tabla_ops);
+
+/**
+ * Valida la expresion postfija que ocupa el resto del string, sin armarla
+ * (igual que 'parsear' con una carga perezosa). Si es invalida, devuelve 0 y
+ * guarda el error en 'error'.
+ */
+int validar_expresion(char const* str, TablaOps* tabla_ops, ErrorTag* error);
+
+/**
+ * Devuelve el largo del string si este es un alias valido (un nombre que no es
+ * una palabra clave ni contiene operadores), o 0 si no lo es.
+ */
+int parsear_alias(char const* str, TablaOps* tabla_ops);
 
 #endif // PARSER_H
@@ -0,0 +1,301 @@
+#include "simplificar.h"
+
+#include "expresion.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Profundidad maxima de recursion. Las cadenas asociativas y las aplicaciones
+// de operaciones involutivas se recorren sin recursion, pero el resto de las
+// operaciones anidadas no: mas alla de este limite, no se simplifica.
+#define PROFUNDIDAD_MAXIMA 10000
+
+// Estado de la simplificacion de una expresion.
+typedef struct {
+	TablaOps* ops;
+	Expresion* original;
+	Expresion* resultado;
+	// Pila con los operandos de las cadenas asociativas que se estan
+	// aplanando. Cada cadena usa un tramo, por encima de los tramos de las
+	// cadenas que la contienen.
+	int* operandos;
+	int cantidadOperandos;
+	int capacidadOperandos;
+	// Los operandos numericos de la cadena actual, para reducirlos a uno.
+	int* numeros;
+	int capacidadNumeros;
+	int profundidad;
+	int cambios; // si se aplico alguna regla.
+	int abortado; // si se supero PROFUNDIDAD_MAXIMA.
+} Simplificador;
+
+// Agrega un indice a la pila de operandos.
+static void apilar_operando(Simplificador* s, int i) {
+	if (s->cantidadOperandos == s->capacidadOperandos) {
+		s->capacidadOperandos = s->capacidadOperandos ? 
+			s->capacidadOperandos * 2 : 64;
+		s->operandos = 
+			realloc(s->operandos, s->capacidadOperandos * sizeof(int));
+		assert(s->operandos);
+	}
+	s->operandos[s->cantidadOperandos++] = i;
+}
+
+// Agrega una operacion al resultado, salvo que se haya abortado (en cuyo caso
+// podrian faltar sus operandos).
+static void emitir_operacion(Simplificador* s, EntradaTablaOps* op) {
+	if (!s->abortado)
+		expresion_operacion(&s->resultado, op);
+}
+
+static EntradaTablaOps* operador_de(Simplificador* s, int i) {
+	return &s->ops->entradas[s->original->nodos[i].op];
+}
+
+// Determina si el nodo es el numero neutro de la operacion.
+static int es_neutro(Simplificador* s, int i, EntradaTablaOps* op) {
+	Nodo const* nodo = &s->original->nodos[i];
+	return (op->propiedades & OP_NEUTRO) && nodo->tag == X_NUMERO &&
+		nodo->valor == op->neutro;
+}
+
+// Determina si el nodo es una aplicacion binaria del operador dado.
+static int es_operacion(Simplificador* s, int i, EntradaTablaOps* op) {
+	Nodo const* nodo = &s->original->nodos[i];
+	return nodo->tag == X_OPERACION && nodo->op == op->id;
+}
+
+// Agrega al resultado la aplicacion de la operacion asociativa a sus ultimos
+// 'cantidad' subarboles: una operacion binaria si son dos, o una cadena si son
+// mas.
+static void emitir_cadena(Simplificador* s, EntradaTablaOps* op,
+	int cantidad) {
+	if (cantidad == 2)
+		emitir_operacion(s, op);
+	else if (cantidad > 2 && !s->abortado)
+		expresion_cadena(&s->resultado, op, cantidad);
+}
+
+// Junta los alias repetidos entre los 'cantidad' operandos del tramo de la
+// pila de operandos que empieza en 'base': deja solo la primera aparicion de
+// cada alias (sin cambiar el orden de las primeras apariciones), y guarda en
+// 'repeticiones' cuantas veces aparece cada operando que queda. Los alias se
+// buscan en una tabla hash (con direccionamiento abierto) de los que quedan.
+// Devuelve la cantidad de operandos que quedan. Si no hay repetidos,
+// 'repeticiones' queda en NULL.
+static int agrupar_alias(Simplificador* s, int base, int cantidad,
+	int** repeticiones) {
+	int capacidad = 16;
+	while (capacidad < 2 * cantidad)
+		capacidad *= 2;
+	int* vistos = malloc(capacidad * sizeof(int));
+	int* veces = malloc(cantidad * sizeof(int));
+	assert(vistos && veces);
+	for (int k = 0; k < capacidad; ++k)
+		vistos[k] = -1;
+	int quedan = 0;
+	for (int k = 0; k < cantidad; ++k) {
+		int j = s->operandos[base + k];
+		Nodo const* nodo = &s->original->nodos[j];
+		if (nodo->tag == X_ALIAS) {
+			// FNV-1a del alias.
+			uint32_t hash = 2166136261u;
+			for (int c = 0; c < nodo->valor; ++c)
+				hash = (hash ^ (unsigned char)nodo->alias[c]) * 16777619u;
+			int h = hash & (capacidad - 1);
+			for (; vistos[h] >= 0; h = (h + 1) & (capacidad - 1)) {
+				Nodo const* visto =
+					&s->original->nodos[s->operandos[base + vistos[h]]];
+				if (visto->valor == nodo->valor &&
+					memcmp(visto->alias, nodo->alias, nodo->valor) == 0)
+					break;
+			}
+			if (vistos[h] >= 0) {
+				veces[vistos[h]] += 1;
+				continue;
+			}
+			vistos[h] = quedan;
+		}
+		s->operandos[base + quedan] = j;
+		veces[quedan++] = 1;
+	}
+	free(vistos);
+	if (quedan == cantidad) {
+		free(veces);
+		veces = NULL;
+	}
+	*repeticiones = veces;
+	return quedan;
+}
+
+// Agrega al resultado el subarbol con raiz en el nodo 'i' de la original, ya
+// simplificado.
+static void simplificar_nodo(Simplificador* s, int i);
+
+// Simplifica la cadena de la operacion asociativa con raiz en el nodo 'i'.
+static void simplificar_cadena(Simplificador* s, int i, EntradaTablaOps* op) {
+	// Juntamos los operandos de la cadena, de izquierda a derecha, en un tramo
+	// nuevo de la pila de operandos. Para recorrer la cadena sin recursion,
+	// usamos una pila auxiliar de nodos pendientes.
+	int base = s->cantidadOperandos;
+	int capacidad = 64, tope = 0;
+	int* pendientes = malloc(capacidad * sizeof(int));
+	assert(pendientes);
+	pendientes[tope++] = i;
+	while (tope > 0) {
+		int j = pendientes[--tope];
+		if (!es_operacion(s, j, op)) {
+			apilar_operando(s, j);
+			continue;
+		}
+		if (tope + 2 > capacidad) {
+			capacidad *= 2;
+			pendientes = realloc(pendientes, capacidad * sizeof(int));
+			assert(pendientes);
+		}
+		// El izquierdo queda en el tope, para visitarlo primero.
+		pendientes[tope++] = expresion_sub(s->original, j, 0);
+		pendientes[tope++] = expresion_sub(s->original, j, 1);
+	}
+	free(pendientes);
+
+	// Quitamos los neutros. Si la operacion no conmuta, el neutro solo lo es a
+	// derecha, por lo que el primer operando se conserva.
+	int cantidad = s->cantidadOperandos - base;
+	int quedan = 0;
+	for (int k = 0; k < cantidad; ++k) {
+		int j = s->operandos[base + k];
+		int conservar = !es_neutro(s, j, op) ||
+			(k == 0 && !(op->propiedades & OP_CONMUTATIVA));
+		if (conservar)
+			s->operandos[base + quedan++] = j;
+	}
+	// Si todos eran neutros, queda uno.
+	if (quedan == 0)
+		quedan = 1;
+	if (quedan != cantidad || cantidad > 2)
+		s->cambios = 1;
+
+	// Si la operacion conmuta, el orden de los operandos no importa: reducimos
+	// los numeros a uno solo, que va al final (salvo que sea el neutro).
+	int numeros = 0;
+	if (op->propiedades & OP_CONMUTATIVA) {
+		if (s->capacidadNumeros < quedan) {
+			s->capacidadNumeros = quedan;
+			s->numeros = realloc(s->numeros, quedan * sizeof(int));
+			assert(s->numeros);
+		}
+		int otros = 0;
+		for (int k = 0; k < quedan; ++k) {
+			int j = s->operandos[base + k];
+			if (s->original->nodos[j].tag == X_NUMERO)
+				s->numeros[numeros++] = s->original->nodos[j].valor;
+			else
+				s->operandos[base + otros++] = j;
+		}
+		quedan = otros;
+		if (numeros > 1)
+			s->cambios = 1;
+	}
+	int valor = numeros ? tabla_ops_reducir(op, s->numeros, numeros) : 0;
+	if (numeros && quedan > 0 && (op->propiedades & OP_NEUTRO) &&
+		valor == op->neutro)
+		numeros = 0;
+
+	// Si la operacion repetida tiene su propio operador, cada alias se evalua
+	// una sola vez: 'x y + x + x +' queda como 'x 3 * y +'.
+	int* repeticiones = NULL;
+	if (op->repeticion >= 0 && quedan > 1) {
+		int agrupados = agrupar_alias(s, base, quedan, &repeticiones);
+		if (agrupados != quedan)
+			s->cambios = 1;
+		quedan = agrupados;
+	}
+	s->cantidadOperandos = base + quedan;
+
+	// Aplanamos la cadena: sus operandos, y la operacion aplicada a todos.
+	for (int k = 0; k < quedan; ++k) {
+		simplificar_nodo(s, s->operandos[base + k]);
+		if (repeticiones && repeticiones[k] > 1) {
+			expresion_numero(&s->resultado, repeticiones[k]);
+			emitir_operacion(s, &s->ops->entradas[op->repeticion]);
+		}
+	}
+	free(repeticiones);
+	if (numeros)
+		expresion_numero(&s->resultado, valor);
+	emitir_cadena(s, op, quedan + (numeros > 0));
+	s->cantidadOperandos = base;
+}
+
+static void simplificar_nodo(Simplificador* s, int i) {
+	Nodo const* nodo = &s->original->nodos[i];
+	if (nodo->tag == X_NUMERO) {
+		expresion_numero(&s->resultado, nodo->valor);
+		return;
+	}
+	if (nodo->tag == X_ALIAS) {
+		expresion_alias(&s->resultado, nodo->alias, nodo->valor);
+		return;
+	}
+	if (s->abortado || s->profundidad == PROFUNDIDAD_MAXIMA) {
+		s->abortado = 1;
+		return;
+	}
+	s->profundidad += 1;
+
+	EntradaTablaOps* op = operador_de(s, i);
+	if (op->aridad == 1) {
+		// Contamos las aplicaciones consecutivas: si es involutiva, solo
+		// importa su paridad.
+		int veces = 1;
+		int j = expresion_sub(s->original, i, 0);
+		if (op->propiedades & OP_INVOLUTIVA)
+			for (; es_operacion(s, j, op); j = expresion_sub(s->original, j, 0))
+				veces += 1;
+		if (veces > 1)
+			s->cambios = 1;
+		simplificar_nodo(s, j);
+		if (veces % 2 == 1 || !(op->propiedades & OP_INVOLUTIVA))
+			emitir_operacion(s, op);
+	}
+	else if (op->propiedades & OP_ASOCIATIVA)
+		simplificar_cadena(s, i, op);
+	else {
+		int izquierdo = expresion_sub(s->original, i, 1);
+		int derecho = expresion_sub(s->original, i, 0);
+		if (es_neutro(s, derecho, op)) {
+			s->cambios = 1;
+			simplificar_nodo(s, izquierdo);
+		}
+		else if ((op->propiedades & OP_CONMUTATIVA) && es_neutro(s, izquierdo, op)) {
+			s->cambios = 1;
+			simplificar_nodo(s, derecho);
+		}
+		else {
+			simplificar_nodo(s, izquierdo);
+			simplificar_nodo(s, derecho);
+			emitir_operacion(s, op);
+		}
+	}
+
+	s->profundidad -= 1;
+}
+
+Expresion* simplificar(Expresion* expresion, TablaOps* ops) {
+	Simplificador s = {
+		.ops = ops,
+		.original = expresion,
+		.resultado = expresion_crear(expresion->n),
+	};
+	simplificar_nodo(&s, expresion->n - 1);
+	free(s.operandos);
+	free(s.numeros);
+	if (!s.cambios || s.abortado) {
+		expresion_limpiar(s.resultado);
+		return NULL;
+	}
+	return s.resultado;
+}
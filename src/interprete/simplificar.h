@@ -0,0 +1,32 @@
+#ifndef SIMPLIFICAR_H
+#define SIMPLIFICAR_H
+
+#include "../tabla_ops.h"
+
+typedef struct Expresion Expresion;
+
+/**
+ * Reescribe la expresion usando las propiedades algebraicas de sus operadores
+ * (ver OP_ASOCIATIVA, etc.):
+ *  - quita los operandos que son el elemento neutro de su operacion;
+ *  - cancela las aplicaciones consecutivas de una operacion involutiva;
+ *  - aplana las cadenas de mas de dos operandos de una operacion asociativa
+ *    en un solo nodo X_CADENA, precedido por sus operandos;
+ *  - si la operacion ademas conmuta, reduce los operandos numericos de cada
+ *    cadena a uno solo (con 'tabla_ops_reducir'), que queda al final;
+ *  - si ademas tiene una repeticion (ver 'cargar_repeticion'), reduce la
+ *    fuerza de las cadenas que repiten un alias: lo evalua una sola vez, y le
+ *    aplica la repeticion con la cantidad de apariciones.
+ * Fuera de eso, los operandos de una cadena mantienen su orden, por lo que no
+ * hace falta que la operacion sea conmutativa para aplanarla.
+ * La expresion resultante usa los mismos alias que la original.
+ **
+ * # uso de memoria:
+ * argumentos: No limpia nada;
+ * resultado: una expresion nueva, que se debe limpiar. Si no hay nada para
+ *  simplificar (o la expresion es demasiado profunda para recorrerla), devuelve
+ *  NULL.
+ */
+Expresion* simplificar(Expresion* expresion, TablaOps* ops);
+
+#endif // SIMPLIFICAR_H
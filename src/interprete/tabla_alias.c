@@ -0,0 +1,355 @@
+#include "tabla_alias.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cada nivel del trie distingue BITS bits del hash. En el nivel NIVELES ya se
+// usaron todos los bits, por lo que sus nodos son de colisiones: guardan, sin
+// mapa de bits, entradas cuyos hashes son iguales.
+#define BITS 5
+#define NIVELES 7
+
+// Un hijo de un nodo es un subarbol o una entrada (el otro campo es NULL).
+typedef struct {
+	NodoTablaAlias* nodo;
+	EntradaTablaAlias* entrada;
+} HijoTablaAlias;
+
+struct NodoTablaAlias {
+	int referencias; // cantidad de tablas y nodos que lo contienen.
+	int marca;       // ultimo recorrido de 'ta_memoria' que lo conto.
+	uint32_t mapa;   // el bit k indica si hay un hijo con fragmento k.
+	int cantidad;
+	HijoTablaAlias hijos[]; // ordenados por fragmento.
+};
+
+// Funcion de hash FNV-1a.
+static uint32_t hash_alias(char const* alias, int alias_n) {
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < alias_n; ++i)
+		h = (h ^ (unsigned char)alias[i]) * 16777619u;
+	return h;
+}
+
+// Devuelve el bit del mapa que corresponde al hash en el nivel dado.
+static uint32_t bit_de(uint32_t hash, int nivel) {
+	return 1u << ((hash >> (BITS * nivel)) & ((1u << BITS) - 1));
+}
+
+// Devuelve la posicion del hijo con el bit dado entre los hijos del nodo.
+static int posicion(NodoTablaAlias const* nodo, uint32_t bit) {
+	return __builtin_popcount(nodo->mapa & (bit - 1));
+}
+
+static int es_alias(EntradaTablaAlias const* entrada, uint32_t hash,
+	char const* alias, int alias_n) {
+	return entrada->hash == hash && entrada->alias_n == alias_n &&
+		memcmp(entrada->alias, alias, alias_n) == 0;
+}
+
+// Devuelve un nodo sin hijos, con lugar para la cantidad dada.
+static NodoTablaAlias* nodo_crear(int capacidad) {
+	NodoTablaAlias* nodo =
+		malloc(sizeof(NodoTablaAlias) + capacidad * sizeof(HijoTablaAlias));
+	assert(nodo);
+	nodo->referencias = 1;
+	nodo->marca = 0;
+	nodo->mapa = 0;
+	nodo->cantidad = 0;
+	return nodo;
+}
+
+// Suelta una referencia a la entrada. Si era la ultima, la libera junto a su
+// input y sus expresiones.
+static void entrada_soltar(EntradaTablaAlias* entrada) {
+	if (--entrada->referencias > 0)
+		return;
+	expresion_limpiar(entrada->expresion);
+	expresion_limpiar(entrada->simplificada);
+	free(entrada->input);
+	free(entrada);
+}
+
+// Suelta una referencia al nodo. Si era la ultima, lo libera y suelta a sus
+// hijos.
+static void nodo_soltar(NodoTablaAlias* nodo) {
+	if (nodo == NULL || --nodo->referencias > 0)
+		return;
+	for (int i = 0; i < nodo->cantidad; ++i) {
+		if (nodo->hijos[i].nodo)
+			nodo_soltar(nodo->hijos[i].nodo);
+		else
+			entrada_soltar(nodo->hijos[i].entrada);
+	}
+	free(nodo);
+}
+
+// Devuelve una version del nodo que es solo del llamador, con lugar para
+// 'extra' hijos mas. Si el nodo esta compartido, lo copia (y suelta la
+// referencia al original); si no, lo reutiliza.
+static NodoTablaAlias* nodo_propio(NodoTablaAlias* nodo, int extra) {
+	if (nodo->referencias == 1) {
+		if (extra) {
+			nodo = realloc(nodo, sizeof(NodoTablaAlias) +
+				(nodo->cantidad + extra) * sizeof(HijoTablaAlias));
+			assert(nodo);
+		}
+		return nodo;
+	}
+	NodoTablaAlias* copia = nodo_crear(nodo->cantidad + extra);
+	copia->marca = nodo->marca;
+	copia->mapa = nodo->mapa;
+	copia->cantidad = nodo->cantidad;
+	memcpy(copia->hijos, nodo->hijos, nodo->cantidad * sizeof(HijoTablaAlias));
+	// Los hijos ahora estan tambien en la copia.
+	for (int i = 0; i < copia->cantidad; ++i) {
+		if (copia->hijos[i].nodo)
+			copia->hijos[i].nodo->referencias += 1;
+		else
+			copia->hijos[i].entrada->referencias += 1;
+	}
+	nodo->referencias -= 1;
+	return copia;
+}
+
+// Inserta la entrada en el subarbol, que debe ser solo del llamador, y
+// devuelve su nueva raiz. Si reemplaza a la entrada de un alias igual, la
+// guarda en 'reemplazada' (sin soltarla).
+static NodoTablaAlias* nodo_insertar(NodoTablaAlias* nodo,
+	EntradaTablaAlias* entrada, int nivel, EntradaTablaAlias** reemplazada) {
+	if (nivel == NIVELES) {
+		for (int i = 0; i < nodo->cantidad; ++i) {
+			EntradaTablaAlias* it = nodo->hijos[i].entrada;
+			if (es_alias(it, entrada->hash, entrada->alias, entrada->alias_n)) {
+				*reemplazada = it;
+				nodo->hijos[i].entrada = entrada;
+				return nodo;
+			}
+		}
+		nodo = nodo_propio(nodo, 1);
+		nodo->hijos[nodo->cantidad++] = (HijoTablaAlias){ NULL, entrada };
+		return nodo;
+	}
+
+	uint32_t bit = bit_de(entrada->hash, nivel);
+	int pos = posicion(nodo, bit);
+	// No hay hijo en ese lugar: lo agregamos.
+	if (!(nodo->mapa & bit)) {
+		nodo = nodo_propio(nodo, 1);
+		memmove(&nodo->hijos[pos + 1], &nodo->hijos[pos],
+			(nodo->cantidad - pos) * sizeof(HijoTablaAlias));
+		nodo->hijos[pos] = (HijoTablaAlias){ NULL, entrada };
+		nodo->mapa |= bit;
+		nodo->cantidad += 1;
+		return nodo;
+	}
+
+	HijoTablaAlias* hijo = &nodo->hijos[pos];
+	if (hijo->nodo) {
+		hijo->nodo = nodo_insertar(nodo_propio(hijo->nodo, 0), entrada,
+			nivel + 1, reemplazada);
+	}
+	else if (es_alias(hijo->entrada, entrada->hash, entrada->alias,
+		entrada->alias_n)) {
+		*reemplazada = hijo->entrada;
+		hijo->entrada = entrada;
+	}
+	else {
+		// Dos alias distintos en el mismo lugar: los bajamos a un nodo nuevo.
+		NodoTablaAlias* sub = nodo_crear(2);
+		sub = nodo_insertar(sub, hijo->entrada, nivel + 1, reemplazada);
+		sub = nodo_insertar(sub, entrada, nivel + 1, reemplazada);
+		*hijo = (HijoTablaAlias){ sub, NULL };
+	}
+	return nodo;
+}
+
+// Quita al hijo en la posicion dada del nodo, que debe ser del llamador.
+static void nodo_quitar(NodoTablaAlias* nodo, int pos, uint32_t bit) {
+	memmove(&nodo->hijos[pos], &nodo->hijos[pos + 1],
+		(nodo->cantidad - pos - 1) * sizeof(HijoTablaAlias));
+	nodo->mapa &= ~bit;
+	nodo->cantidad -= 1;
+}
+
+// Quita el alias del subarbol, que debe ser del llamador y contenerlo, y
+// guarda su entrada en 'borrada' (sin soltarla). Devuelve la nueva raiz del
+// subarbol, o NULL si queda vacio. Un subarbol que queda con una sola entrada
+// se reemplaza por ella, para que el trie no tenga caminos innecesarios.
+static NodoTablaAlias* nodo_borrar(NodoTablaAlias* nodo, uint32_t hash,
+	char const* alias, int alias_n, int nivel, EntradaTablaAlias** borrada) {
+	if (nivel == NIVELES) {
+		int pos = 0;
+		while (!es_alias(nodo->hijos[pos].entrada, hash, alias, alias_n))
+			pos += 1;
+		*borrada = nodo->hijos[pos].entrada;
+		nodo_quitar(nodo, pos, 0);
+	}
+	else {
+		uint32_t bit = bit_de(hash, nivel);
+		int pos = posicion(nodo, bit);
+		HijoTablaAlias* hijo = &nodo->hijos[pos];
+		if (hijo->entrada) {
+			*borrada = hijo->entrada;
+			nodo_quitar(nodo, pos, bit);
+		}
+		else {
+			NodoTablaAlias* sub = nodo_borrar(nodo_propio(hijo->nodo, 0), hash,
+				alias, alias_n, nivel + 1, borrada);
+			if (sub == NULL)
+				nodo_quitar(nodo, pos, bit);
+			else if (sub->cantidad == 1 && sub->hijos[0].entrada) {
+				*hijo = sub->hijos[0];
+				free(sub);
+			}
+			else
+				hijo->nodo = sub;
+		}
+	}
+	if (nodo->cantidad > 0)
+		return nodo;
+	free(nodo);
+	return NULL;
+}
+
+// Suma los bytes del subarbol que todavia no se contaron en el recorrido
+// 'marca', y los marca.
+static size_t nodo_memoria(NodoTablaAlias* nodo, int marca) {
+	if (nodo->marca == marca)
+		return 0;
+	nodo->marca = marca;
+	size_t bytes = sizeof(NodoTablaAlias) +
+		nodo->cantidad * sizeof(HijoTablaAlias);
+	for (int i = 0; i < nodo->cantidad; ++i) {
+		EntradaTablaAlias* entrada = nodo->hijos[i].entrada;
+		if (nodo->hijos[i].nodo)
+			bytes += nodo_memoria(nodo->hijos[i].nodo, marca);
+		else if (entrada->marca != marca) {
+			entrada->marca = marca;
+			bytes += sizeof(EntradaTablaAlias);
+			if (entrada->input)
+				bytes += strlen(entrada->input) + 1;
+			if (entrada->expresion)
+				bytes += sizeof(Expresion) +
+					entrada->expresion->capacidad * sizeof(Nodo);
+			if (entrada->simplificada)
+				bytes += sizeof(Expresion) +
+					entrada->simplificada->capacidad * sizeof(Nodo);
+		}
+	}
+	return bytes;
+}
+
+// Agrega las entradas del subarbol al arreglo, a partir de la posicion 'n'.
+// Devuelve la posicion siguiente a la ultima escrita.
+static int nodo_listar(NodoTablaAlias* nodo, EntradaTablaAlias** entradas,
+	int n) {
+	for (int i = 0; i < nodo->cantidad; ++i) {
+		if (nodo->hijos[i].nodo)
+			n = nodo_listar(nodo->hijos[i].nodo, entradas, n);
+		else
+			entradas[n++] = nodo->hijos[i].entrada;
+	}
+	return n;
+}
+
+// Compara dos entradas por su numero de definicion, para 'qsort'.
+static int comparar_orden(void const* a, void const* b) {
+	EntradaTablaAlias* const* x = a;
+	EntradaTablaAlias* const* y = b;
+	return ((*x)->orden > (*y)->orden) - ((*x)->orden < (*y)->orden);
+}
+
+TablaAlias ta_crear(void) {
+	return (TablaAlias){ NULL, 0, 0 };
+}
+
+EntradaTablaAlias* ta_encontrar(TablaAlias* tabla, char const* alias,
+	int alias_n) {
+	uint32_t hash = hash_alias(alias, alias_n);
+	NodoTablaAlias* nodo = tabla->raiz;
+	for (int nivel = 0; nodo; ++nivel) {
+		if (nivel == NIVELES) {
+			for (int i = 0; i < nodo->cantidad; ++i)
+				if (es_alias(nodo->hijos[i].entrada, hash, alias, alias_n))
+					return nodo->hijos[i].entrada;
+			return NULL;
+		}
+		uint32_t bit = bit_de(hash, nivel);
+		if (!(nodo->mapa & bit))
+			return NULL;
+		HijoTablaAlias* hijo = &nodo->hijos[posicion(nodo, bit)];
+		if (hijo->entrada)
+			return es_alias(hijo->entrada, hash, alias, alias_n) ?
+				hijo->entrada : NULL;
+		nodo = hijo->nodo;
+	}
+	return NULL;
+}
+
+EntradaTablaAlias* ta_insertar_o_reemplazar(TablaAlias* tabla,
+	EntradaTablaAlias datos) {
+	EntradaTablaAlias* nueva = malloc(sizeof(*nueva));
+	assert(nueva);
+	*nueva = datos;
+	nueva->referencias = 1;
+	nueva->hash = hash_alias(datos.alias, datos.alias_n);
+
+	NodoTablaAlias* raiz = tabla->raiz ?
+		nodo_propio(tabla->raiz, 0) : nodo_crear(1);
+	EntradaTablaAlias* reemplazada = NULL;
+	tabla->raiz = nodo_insertar(raiz, nueva, 0, &reemplazada);
+	// Un alias redefinido conserva su numero de definicion.
+	if (reemplazada) {
+		nueva->orden = reemplazada->orden;
+		entrada_soltar(reemplazada);
+	}
+	else {
+		nueva->orden = tabla->definidos++;
+		tabla->cantidad += 1;
+	}
+	return nueva;
+}
+
+int ta_borrar(TablaAlias* tabla, char const* alias, int alias_n) {
+	if (ta_encontrar(tabla, alias, alias_n) == NULL)
+		return 0;
+	EntradaTablaAlias* borrada = NULL;
+	tabla->raiz = nodo_borrar(nodo_propio(tabla->raiz, 0),
+		hash_alias(alias, alias_n), alias, alias_n, 0, &borrada);
+	entrada_soltar(borrada);
+	tabla->cantidad -= 1;
+	return 1;
+}
+
+void ta_retener(EntradaTablaAlias* entrada) {
+	entrada->referencias += 1;
+}
+
+void ta_soltar(EntradaTablaAlias* entrada) {
+	entrada_soltar(entrada);
+}
+
+size_t ta_memoria(TablaAlias* tabla, int marca) {
+	return tabla->raiz ? nodo_memoria(tabla->raiz, marca) : 0;
+}
+
+TablaAlias ta_copiar(TablaAlias* tabla) {
+	if (tabla->raiz)
+		tabla->raiz->referencias += 1;
+	return *tabla;
+}
+
+void ta_listar(TablaAlias* tabla, EntradaTablaAlias** entradas) {
+	if (tabla->raiz == NULL)
+		return;
+	int n = nodo_listar(tabla->raiz, entradas, 0);
+	assert(n == tabla->cantidad);
+	qsort(entradas, n, sizeof(*entradas), comparar_orden);
+}
+
+void ta_limpiar(TablaAlias* tabla) {
+	nodo_soltar(tabla->raiz);
+	*tabla = ta_crear();
+}
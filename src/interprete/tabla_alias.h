@@ -0,0 +1,144 @@
+#ifndef TABLA_ALIAS_H
+#define TABLA_ALIAS_H
+
+#include "expresion.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Explicacion:
+// para simplificar el uso de memoria, en vez de guardar los aliases, cada uno
+// en su propia region de memoria, referenciamos su posicion original en la
+// linea que ingreso el usuario, mediante un puntero. (char const* alias)
+// Esta linea se guarda en su entrada correspondiente en la tabla de aliases
+// especificamente, el puntero al buffer de entrada va en el campo 'input' de
+// EntradaTablaAlias
+
+// Almacena los datos de un alias definido por el usuario.
+// Una entrada puede estar en varias versiones de la tabla a la vez (ver
+// 'ta_copiar'): se libera, junto a su input y sus expresiones, cuando ya no
+// esta en ninguna.
+typedef struct EntradaTablaAlias {
+	int referencias; // nodos de tablas que la contienen, mas retenciones.
+	int orden;       // numero de definicion del alias (ver 'ta_listar').
+	uint32_t hash;
+	char* input;
+	char const* alias;
+	int alias_n;
+	// la expresion original, que es la que se imprime. Si la carga fue
+	// perezosa, es NULL hasta que se use el alias por primera vez: mientras
+	// tanto, 'fuente' apunta al texto de la expresion dentro de 'input'.
+	Expresion* expresion;
+	char const* fuente;
+	// la expresion simplificada, que es la que se evalua. Si es NULL, se evalua
+	// la original.
+	Expresion* simplificada;
+	// la expresion residual de una especializacion del alias, que se evalua en
+	// lugar de las otras mientras exista. No es de la entrada (la libera quien
+	// la especializo).
+	Expresion* residual;
+	int congelada; // cantidad de especializaciones que dependen de la entrada.
+	// Para recorridos del grafo de alias: 'marca' indica en que recorrido se
+	// visito la entrada por ultima vez. El resto de los campos solo es valido
+	// durante ese recorrido.
+	int marca;
+	int enCurso;   // si la entrada esta siendo recorrida (sirve para hallar ciclos).
+	int alcanza;   // si el alias depende del alias buscado.
+	int usos;      // cantidad de referencias al alias desde el alias mostrado.
+	size_t tamano; // cota del largo de la expansion del alias al imprimirlo,
+	               // o largo de su residuo al especializar.
+	int indice;    // posicion del alias en el lote de 'evaluar todos', o de su
+	               // residuo (o su valor, si es constante) al especializar.
+	// Igual que 'marca', pero para los chequeos previos a una evaluacion, que
+	// pueden ocurrir durante otro recorrido (al actualizar un observado).
+	int chequeo;
+	int chequeando; // si la entrada esta siendo chequeada.
+	int altura;     // lugares de la pila que usa la evaluacion del alias.
+	// lugares de la pila que usa la evaluacion del alias en la tabla actual,
+	// que se guardan entre sentencias mientras 'alturaVigente' sea distinto de
+	// 0 (ver 'pila_ajustar' en interpretar.c).
+	int alturaEvaluacion;
+	int alturaVigente;
+} EntradaTablaAlias;
+
+typedef struct NodoTablaAlias NodoTablaAlias;
+
+// Almacena los alias definidos por el usuario, en un mapa persistente: un HAMT
+// (hash array mapped trie). Cada nodo interno distingue 5 bits del hash del
+// alias, y guarda solo los hijos presentes, indicados en un mapa de bits.
+//
+// Los nodos y las entradas se comparten entre versiones de la tabla, con
+// conteo de referencias: copiar una tabla cuesta O(1), y una modificacion solo
+// copia los nodos del camino que todavia estan compartidos (los que son de una
+// sola tabla se modifican en el lugar).
+typedef struct {
+	NodoTablaAlias* raiz;
+	int cantidad;   // cantidad de alias en la tabla.
+	int definidos;  // cantidad de alias distintos definidos en su historia.
+} TablaAlias;
+
+/**
+ * Devuelve una tabla vacia.
+ */
+TablaAlias ta_crear(void);
+
+/**
+ * Busca un alias en la tabla de alias. De no encontrarlo devuelve NULL.
+ */
+EntradaTablaAlias* ta_encontrar(TablaAlias* tabla, char const* alias,
+	int alias_n);
+
+/**
+ * Agrega a la tabla una entrada con los datos dados (se ignoran los campos
+ * 'referencias', 'orden' y 'hash'), reemplazando a la del mismo alias de
+ * haberla. La entrada reemplazada se libera si no queda en ninguna tabla.
+ * Devuelve la entrada nueva.
+ */
+EntradaTablaAlias* ta_insertar_o_reemplazar(TablaAlias* tabla,
+	EntradaTablaAlias datos);
+
+/**
+ * Quita el alias de la tabla. Su entrada se libera si no queda en ninguna
+ * tabla. Devuelve 0 si el alias no estaba.
+ */
+int ta_borrar(TablaAlias* tabla, char const* alias, int alias_n);
+
+/**
+ * Agrega una referencia a la entrada, que asi sigue viva aunque se quite de
+ * todas las tablas.
+ */
+void ta_retener(EntradaTablaAlias* entrada);
+
+/**
+ * Suelta una referencia agregada con 'ta_retener'. Si era la ultima, la entrada
+ * se libera.
+ */
+void ta_soltar(EntradaTablaAlias* entrada);
+
+/**
+ * Devuelve los bytes que ocupan los nodos y las entradas de la tabla (con sus
+ * inputs y expresiones), sin contar los que ya se contaron con la misma
+ * 'marca': asi, al sumar varias versiones, los datos compartidos se cuentan
+ * una vez. Usa el campo 'marca' de las entradas.
+ */
+size_t ta_memoria(TablaAlias* tabla, int marca);
+
+/**
+ * Devuelve otra version de la tabla, con los mismos alias, que comparte todos
+ * sus datos. Las modificaciones de una no afectan a la otra. Ambas deben
+ * limpiarse.
+ */
+TablaAlias ta_copiar(TablaAlias* tabla);
+
+/**
+ * Guarda las entradas de la tabla en 'entradas' (de tamano tabla->cantidad),
+ * en el orden en que se definieron sus alias por primera vez.
+ */
+void ta_listar(TablaAlias* tabla, EntradaTablaAlias** entradas);
+
+/**
+ * Suelta los nodos de la tabla, liberando los que no quedan en otra version.
+ */
+void ta_limpiar(TablaAlias* tabla);
+
+#endif // TABLA_ALIAS_H
@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "traza.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Cantidad de eventos que guarda el buffer de cada hilo.
+#define EVENTOS_POR_HILO (1 << 16)
+// Cantidad de caracteres del alias que se guardan en cada evento.
+#define LARGO_ALIAS 32
+
+// Un intervalo registrado. El alias se copia, ya que el buffer de la linea
+// puede reutilizarse antes de escribir la traza.
+typedef struct {
+	char const* nombre;
+	uint64_t inicio;
+	uint64_t duracion;
+	int nodos;
+	int alias_n;
+	char alias[LARGO_ALIAS];
+} Evento;
+
+// Buffer circular de eventos de un hilo. Los buffers de todos los hilos
+// forman una lista, para poder recorrerlos al escribir la traza.
+typedef struct BufferTraza BufferTraza;
+struct BufferTraza {
+	BufferTraza* sig;
+	int hilo;
+	uint64_t cantidad; // cantidad total de eventos registrados.
+	Evento eventos[EVENTOS_POR_HILO];
+};
+
+int trazaActiva = 0;
+
+static FILE* archivoTraza = NULL;
+static BufferTraza* buffers = NULL;
+static int cantidadHilos = 0;
+static uint64_t origen = 0;
+
+static __thread BufferTraza* bufferHilo = NULL;
+
+uint64_t traza_reloj(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+}
+
+int traza_iniciar(char const* ruta) {
+	archivoTraza = fopen(ruta, "w");
+	if (archivoTraza == NULL)
+		return 0;
+	origen = traza_reloj();
+	trazaActiva = 1;
+	return 1;
+}
+
+// Devuelve el buffer del hilo actual, creandolo la primera vez. 
+static BufferTraza* buffer_del_hilo(void) {
+	if (bufferHilo == NULL) {
+		BufferTraza* buffer = malloc(sizeof(*buffer));
+		assert(buffer);
+		buffer->cantidad = 0;
+		buffer->hilo = __sync_fetch_and_add(&cantidadHilos, 1);
+		// Lo agregamos a la lista sin bloquear a los demas hilos.
+		do buffer->sig = buffers;
+		while (!__sync_bool_compare_and_swap(&buffers, buffer->sig, buffer));
+		bufferHilo = buffer;
+	}
+	return bufferHilo;
+}
+
+void traza_registrar(char const* nombre, uint64_t inicio,
+	char const* alias, int alias_n, int nodos) {
+	uint64_t fin = traza_reloj();
+	BufferTraza* buffer = buffer_del_hilo();
+	Evento* evento = &buffer->eventos[buffer->cantidad++ % EVENTOS_POR_HILO];
+	evento->nombre = nombre;
+	evento->inicio = inicio - origen;
+	evento->duracion = fin - inicio;
+	evento->nodos = nodos;
+	evento->alias_n = 0;
+	if (alias) {
+		evento->alias_n = alias_n < LARGO_ALIAS ? alias_n : LARGO_ALIAS;
+		memcpy(evento->alias, alias, evento->alias_n);
+	}
+}
+
+// Escribe un evento como un objeto JSON de tipo "X" (intervalo completo).
+// Los tiempos se expresan en microsegundos.
+static void escribir_evento(FILE* archivo, Evento const* evento, int hilo) {
+	fprintf(archivo, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+		"\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+		evento->nombre, hilo, evento->inicio / 1000.0, evento->duracion / 1000.0);
+	char const* separador = "";
+	// Los alias solo tienen letras, digitos y '_', por lo que no hay que
+	// escapar nada.
+	if (evento->alias_n > 0) {
+		fprintf(archivo, "\"alias\":\"%.*s\"", evento->alias_n, evento->alias);
+		separador = ",";
+	}
+	if (evento->nodos >= 0)
+		fprintf(archivo, "%s\"nodos\":%d", separador, evento->nodos);
+	fprintf(archivo, "}}");
+}
+
+void traza_finalizar(void) {
+	if (!trazaActiva)
+		return;
+	trazaActiva = 0;
+	fprintf(archivoTraza, "{\"traceEvents\":[\n");
+	char const* separador = "";
+	BufferTraza* it = buffers;
+	while (it) {
+		// Si el buffer dio la vuelta, el evento mas viejo es el siguiente al
+		// ultimo escrito.
+		uint64_t primero = it->cantidad > EVENTOS_POR_HILO ?
+			it->cantidad - EVENTOS_POR_HILO : 0;
+		for (uint64_t i = primero; i < it->cantidad; ++i) {
+			fputs(separador, archivoTraza);
+			escribir_evento(archivoTraza, &it->eventos[i % EVENTOS_POR_HILO],
+				it->hilo);
+			separador = ",\n";
+		}
+		BufferTraza* sig = it->sig;
+		free(it);
+		it = sig;
+	}
+	fprintf(archivoTraza, "\n],\"displayTimeUnit\":\"ns\"}\n");
+	fclose(archivoTraza);
+	archivoTraza = NULL;
+	buffers = NULL;
+	bufferHilo = NULL;
+}
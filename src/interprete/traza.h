@@ -0,0 +1,58 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+#include <stdint.h>
+
+// Registro de eventos del interprete, en el formato "trace event" de Chrome
+// (se puede abrir con chrome://tracing o con Perfetto).
+//
+// Cada evento es un intervalo de tiempo con nombre (una fase de una sentencia)
+// y, opcionalmente, el alias y la cantidad de nodos involucrados. Los eventos
+// se guardan en un buffer circular por hilo: si se llena, se pierden los mas
+// viejos. Recien se escriben en el archivo al llamar a 'traza_finalizar'.
+//
+// Mientras el registro no este activo, cada medicion cuesta una comparacion.
+
+extern int trazaActiva;
+
+/**
+ * Activa el registro de eventos. Devuelve 0 si no se pudo abrir el archivo.
+ */
+int traza_iniciar(char const* ruta);
+
+/**
+ * Escribe los eventos registrados en el archivo, lo cierra, y libera los
+ * buffers. No tiene efecto si el registro no esta activo.
+ */
+void traza_finalizar(void);
+
+/**
+ * Devuelve el tiempo actual en nanosegundos, para usar como comienzo de un
+ * intervalo.
+ */
+uint64_t traza_reloj(void);
+
+/**
+ * Registra un intervalo que comenzo en 'inicio' y termina ahora. El alias
+ * puede ser NULL, y 'nodos' negativo si no corresponde.
+ */
+void traza_registrar(char const* nombre, uint64_t inicio,
+	char const* alias, int alias_n, int nodos);
+
+/**
+ * Comienzo de un intervalo (0 si el registro no esta activo).
+ */
+static inline uint64_t traza_comienzo(void) {
+	return trazaActiva ? traza_reloj() : 0;
+}
+
+/**
+ * Fin de un intervalo. 'nombre' debe ser una constante.
+ */
+static inline void traza_fin(char const* nombre, uint64_t inicio,
+	char const* alias, int alias_n, int nodos) {
+	if (trazaActiva)
+		traza_registrar(nombre, inicio, alias, alias_n, nodos);
+}
+
+#endif // TRAZA_H
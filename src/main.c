@@ -1,8 +1,135 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "tabla_ops.h"
 #include "operadores.h"
+#include "paralelo.h"
 #include "interprete/interpretar.h"
+#include "interprete/binario.h"
+#include "interprete/traza.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Muestra las opciones del programa.
+static void uso(char const* programa) {
+	fprintf(stderr, "uso: %s [--trace ARCHIVO] [--perezoso] [-j N] "
+		"[--limite-nodos N] [--limite-operaciones N] [--limite-tiempo MS] "
+		"[--diario ARCHIVO | SCRIPT...]\n", programa);
+	fprintf(stderr, "     %s --convertir ARCHIVO\n", programa);
+	fprintf(stderr, "  --trace ARCHIVO  registra la duracion de cada fase de las "
+		"sentencias en ARCHIVO (formato de Chrome).\n");
+	fprintf(stderr, "  --perezoso       arma las expresiones recien cuando se usan.\n");
+	fprintf(stderr, "  -j N             corre hasta N scripts a la vez, y usa N hilos "
+		"en 'evaluar todos'.\n");
+	fprintf(stderr, "  --limite-nodos N, --limite-operaciones N, --limite-tiempo MS\n"
+		"                   cortan con un error la evaluacion de una sentencia que "
+		"recorre mas de N nodos, llama a mas de N operadores o tarda mas de MS "
+		"milisegundos.\n");
+	fprintf(stderr, "  --diario ARCHIVO recupera los alias de ARCHIVO al empezar, y "
+		"agrega alli cada carga y borrado de la sesion.\n");
+	fprintf(stderr, "  --convertir ARCHIVO  convierte las sentencias de la entrada "
+		"estandar al formato binario, y las escribe en ARCHIVO.\n");
+	fprintf(stderr, "Sin scripts, las sentencias se leen por la entrada estandar.\n");
+	fprintf(stderr, "Los scripts y la entrada pueden estar en formato binario.\n");
+}
+
+// Lee el limite de un presupuesto. Devuelve 0 si no es un numero positivo.
+static int leer_limite(char const* texto, long long* limite) {
+	char* fin;
+	*limite = strtoll(texto, &fin, 10);
+	return *fin == '\0' && *limite > 0;
+}
+
+// Datos compartidos por las corridas de los scripts. Cada script escribe su
+// salida en su propio buffer, que se imprime al terminar todos.
+typedef struct {
+	TablaOps* tabla;
+	OpcionesInterprete opciones;
+	char** scripts;
+	char** salidas;
+	size_t* largos;
+	int* fallidos; // si el script no pudo correrse.
+} Corridas;
+
+// Corre el i-esimo script en una sesion propia.
+static void correr_script(void* corridas_, int i) {
+	Corridas* corridas = corridas_;
+	FILE* salida = open_memstream(&corridas->salidas[i], &corridas->largos[i]);
+	if (salida == NULL) {
+		fprintf(stderr, "ERROR: no se pudo correr '%s'.\n", corridas->scripts[i]);
+		corridas->fallidos[i] = 1;
+		return;
+	}
+	FILE* entrada = fopen(corridas->scripts[i], "r");
+	if (entrada == NULL)
+		fprintf(salida, "ERROR: no se pudo abrir \'%s\'.\n", corridas->scripts[i]);
+	else {
+		interpretar(corridas->tabla, corridas->opciones, entrada, salida);
+		fclose(entrada);
+	}
+	fclose(salida);
+}
+
+int main (int argc, char** argv) {
+	int hilos = 1;
+	int estado = 0;
+	OpcionesInterprete opciones = {0};
+	char const* convertir = NULL;
+	// Procesamos las opciones. El resto de los argumentos son scripts.
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; ++i) {
+		if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			if (!traza_iniciar(argv[++i])) {
+				fprintf(stderr, "ERROR: no se pudo abrir \'%s\'.\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--convertir") == 0 && i + 1 < argc)
+			convertir = argv[++i];
+		else if (strcmp(argv[i], "--diario") == 0 && i + 1 < argc)
+			opciones.diario = argv[++i];
+		else if (strcmp(argv[i], "--perezoso") == 0)
+			opciones.perezoso = 1;
+		else if (strcmp(argv[i], "--limite-nodos") == 0 && i + 1 < argc) {
+			if (!leer_limite(argv[++i], &opciones.presupuesto.nodos)) {
+				uso(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--limite-operaciones") == 0 && i + 1 < argc) {
+			if (!leer_limite(argv[++i], &opciones.presupuesto.operaciones)) {
+				uso(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--limite-tiempo") == 0 && i + 1 < argc) {
+			if (!leer_limite(argv[++i], &opciones.presupuesto.milisegundos)) {
+				uso(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			hilos = atoi(argv[++i]);
+			if (hilos < 1) {
+				uso(argv[0]);
+				return 1;
+			}
+		}
+		else {
+			uso(argv[0]);
+			return 1;
+		}
+	}
+	opciones.hilos = hilos;
+	char** scripts = &argv[i];
+	int cantidadScripts = argc - i;
+	// El diario es de una sola sesion.
+	if (opciones.diario != NULL && cantidadScripts > 0) {
+		uso(argv[0]);
+		return 1;
+	}
 
-int main () {
 	// Creamos una tabla de operadores.
 	TablaOps tabla = tabla_ops_crear();
 	
@@ -15,9 +142,63 @@ int main () {
 	cargar_operador(&tabla, "/", 2, division, 5);
 	cargar_operador(&tabla, "^", 2, potencia, 6);
 
-	// Iniciamos la sesion interactiva.
-	interpretar(&tabla);
+	// Declaramos sus propiedades, para simplificar las expresiones.
+	cargar_propiedades(&tabla, "+", OP_ASOCIATIVA | OP_CONMUTATIVA | OP_NEUTRO, 0);
+	cargar_propiedades(&tabla, "*", OP_ASOCIATIVA | OP_CONMUTATIVA | OP_NEUTRO, 1);
+	cargar_propiedades(&tabla, "-", OP_NEUTRO, 0);
+	cargar_propiedades(&tabla, "/", OP_NEUTRO, 1);
+	cargar_propiedades(&tabla, "^", OP_NEUTRO, 1);
+	cargar_propiedades(&tabla, "--", OP_INVOLUTIVA, 0);
+	cargar_reduccion(&tabla, "+", suma_arreglo);
+	cargar_reduccion(&tabla, "*", producto_arreglo);
+	cargar_repeticion(&tabla, "+", "*");
+	cargar_repeticion(&tabla, "*", "^");
+
+	if (convertir != NULL) {
+		// Convertimos la entrada al formato binario.
+		FILE* salida = fopen(convertir, "wb");
+		int ok = salida != NULL && binario_convertir(&tabla, stdin, salida);
+		if (salida != NULL && fclose(salida) != 0)
+			ok = 0;
+		if (!ok) {
+			fprintf(stderr, "ERROR: no se pudo escribir \'%s\'.\n", convertir);
+			tabla_ops_limpiar(&tabla);
+			return 1;
+		}
+	}
+	else if (cantidadScripts == 0) {
+		// Iniciamos la sesion interactiva.
+		if (!interpretar(&tabla, opciones, stdin, stdout))
+			estado = 1;
+	}
+	else {
+		// Corremos los scripts, compartiendo la tabla de operadores, y luego
+		// imprimimos sus salidas en orden.
+		Corridas corridas = {
+			.tabla = &tabla,
+			.opciones = opciones,
+			.scripts = scripts,
+			.salidas = calloc(cantidadScripts, sizeof(char*)),
+			.largos = calloc(cantidadScripts, sizeof(size_t)),
+			.fallidos = calloc(cantidadScripts, sizeof(int)),
+		};
+		paralelo_para(hilos, cantidadScripts, correr_script, &corridas);
+		for (int j = 0; j < cantidadScripts; ++j) {
+			if (corridas.fallidos[j])
+				estado = 1;
+			else
+				fwrite(corridas.salidas[j], 1, corridas.largos[j], stdout);
+			free(corridas.salidas[j]);
+		}
+		free(corridas.salidas);
+		free(corridas.largos);
+		free(corridas.fallidos);
+	}
+
+	// Escribimos la traza, de haberla.
+	traza_finalizar();
 
 	// Limpiamos la tabla de operaciones.
 	tabla_ops_limpiar(&tabla);
+	return estado;
 }
@@ -1,5 +1,9 @@
 #include "operadores.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 int suma(int* args) {
 	return args[1] + args[0];
 }
@@ -24,13 +28,76 @@ int modulo(int* args) {
 	return args[1] % args[0];
 }
 
+// Eleva por cuadrados, en O(log n) multiplicaciones. Se opera sin signo para
+// que el desborde de un resultado grande sea el mismo que multiplicando n
+// veces.
 int potencia(int* args) {
 	int b = args[1];
 	int n = args[0];
 	if (n < 0)
 		return b > 1 ? 0 : 1;
-	int k = 1;
-	while (n--)
-		k *= b;
-	return k;
+	unsigned k = 1;
+	unsigned base = b;
+	for (; n; n >>= 1) {
+		if (n & 1)
+			k *= base;
+		base *= base;
+	}
+	return (int)k;
+}
+
+#ifdef __SSE2__
+// Multiplica cada entero de 32 bits, quedandose con los 32 bits bajos. SSE2
+// solo multiplica los carriles pares (a 64 bits), por lo que los impares se
+// corren a las posiciones pares.
+static inline __m128i multiplicar_carriles(__m128i a, __m128i b) {
+	__m128i pares = _mm_mul_epu32(a, b);
+	__m128i impares = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(pares, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(impares, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Junta los cuatro carriles del acumulador, y devuelve el resultado.
+static inline unsigned juntar_carriles(__m128i v, int producto) {
+	unsigned c[4];
+	_mm_storeu_si128((__m128i*)c, v);
+	return producto ? c[0] * c[1] * c[2] * c[3] : c[0] + c[1] + c[2] + c[3];
+}
+#endif
+
+// Las reducciones operan sin signo, para que el desborde sea el mismo que
+// operando de a pares. Como las operaciones conmutan, se acumula de a 8
+// valores en dos vectores de 4 carriles, y al final se juntan los carriles.
+int suma_arreglo(int const* valores, int n) {
+	unsigned total = 0;
+	int i = 0;
+#ifdef __SSE2__
+	__m128i a = _mm_setzero_si128(), b = _mm_setzero_si128();
+	for (; i + 8 <= n; i += 8) {
+		a = _mm_add_epi32(a, _mm_loadu_si128((__m128i const*)&valores[i]));
+		b = _mm_add_epi32(b, _mm_loadu_si128((__m128i const*)&valores[i + 4]));
+	}
+	total = juntar_carriles(_mm_add_epi32(a, b), 0);
+#endif
+	for (; i < n; ++i)
+		total += (unsigned)valores[i];
+	return (int)total;
+}
+
+int producto_arreglo(int const* valores, int n) {
+	unsigned total = 1;
+	int i = 0;
+#ifdef __SSE2__
+	__m128i a = _mm_set1_epi32(1), b = _mm_set1_epi32(1);
+	for (; i + 8 <= n; i += 8) {
+		a = multiplicar_carriles(a,
+			_mm_loadu_si128((__m128i const*)&valores[i]));
+		b = multiplicar_carriles(b,
+			_mm_loadu_si128((__m128i const*)&valores[i + 4]));
+	}
+	total = juntar_carriles(multiplicar_carriles(a, b), 1);
+#endif
+	for (; i < n; ++i)
+		total *= (unsigned)valores[i];
+	return (int)total;
 }
@@ -9,4 +9,8 @@ int division(int* args);
 int modulo(int* args);
 int potencia(int* args);
 
+// Reducciones de '+' y '*' sobre arreglos (ver 'cargar_reduccion').
+int suma_arreglo(int const* valores, int n);
+int producto_arreglo(int const* valores, int n);
+
 #endif // OPERADORES_H
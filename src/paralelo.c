@@ -0,0 +1,129 @@
+#include "paralelo.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+// Estado compartido por los hilos de un 'paralelo_para'.
+typedef struct {
+	TareaParalela tarea;
+	void* datos;
+	int n;
+	int siguiente; // proximo indice sin tomar.
+} Reparto;
+
+// Cuerpo de cada hilo: toma indices hasta que no queden mas.
+static void* trabajar(void* reparto_) {
+	Reparto* reparto = reparto_;
+	int i;
+	while ((i = __sync_fetch_and_add(&reparto->siguiente, 1)) < reparto->n)
+		reparto->tarea(reparto->datos, i);
+	return NULL;
+}
+
+void paralelo_para(int hilos, int n, TareaParalela tarea, void* datos) {
+	Reparto reparto = { tarea, datos, n, 0 };
+	if (hilos > n)
+		hilos = n;
+	if (hilos <= 1) {
+		trabajar(&reparto);
+		return;
+	}
+	// El hilo actual tambien trabaja, por lo que creamos uno menos.
+	pthread_t* ids = malloc((hilos - 1) * sizeof(*ids));
+	assert(ids);
+	for (int i = 0; i < hilos - 1; ++i) {
+		int error = pthread_create(&ids[i], NULL, trabajar, &reparto);
+		assert(error == 0);
+		(void)error;
+	}
+	trabajar(&reparto);
+	for (int i = 0; i < hilos - 1; ++i)
+		pthread_join(ids[i], NULL);
+	free(ids);
+}
+
+struct Equipo {
+	int hilos;
+	pthread_t* ids;
+	pthread_mutex_t mutex;
+	pthread_cond_t hayRonda;    // se avisa al empezar una ronda (o al cerrar).
+	pthread_cond_t terminaron;  // se avisa cuando ya nadie trabaja.
+	Reparto reparto; // el reparto de la ronda actual.
+	int ronda;       // numero de la ultima ronda.
+	int trabajando;  // hilos del equipo que no terminaron la ronda.
+	int cerrar;
+};
+
+// Cuerpo de cada hilo del equipo: espera cada ronda nueva y trabaja en ella,
+// hasta que se cierra el equipo.
+static void* esperar_rondas(void* equipo_) {
+	Equipo* equipo = equipo_;
+	int vista = 0; // ultima ronda en la que trabajo el hilo.
+	pthread_mutex_lock(&equipo->mutex);
+	while (1) {
+		while (equipo->ronda == vista && !equipo->cerrar)
+			pthread_cond_wait(&equipo->hayRonda, &equipo->mutex);
+		if (equipo->ronda == vista)
+			break;
+		vista = equipo->ronda;
+		pthread_mutex_unlock(&equipo->mutex);
+		trabajar(&equipo->reparto);
+		pthread_mutex_lock(&equipo->mutex);
+		if (--equipo->trabajando == 0)
+			pthread_cond_signal(&equipo->terminaron);
+	}
+	pthread_mutex_unlock(&equipo->mutex);
+	return NULL;
+}
+
+Equipo* equipo_crear(int hilos) {
+	Equipo* equipo = malloc(sizeof(*equipo));
+	assert(equipo);
+	*equipo = (Equipo){ .hilos = hilos < 1 ? 1 : hilos };
+	pthread_mutex_init(&equipo->mutex, NULL);
+	pthread_cond_init(&equipo->hayRonda, NULL);
+	pthread_cond_init(&equipo->terminaron, NULL);
+	// El hilo actual tambien trabaja, por lo que creamos uno menos.
+	equipo->ids = malloc(equipo->hilos * sizeof(*equipo->ids));
+	assert(equipo->ids);
+	for (int i = 0; i < equipo->hilos - 1; ++i) {
+		int error = pthread_create(&equipo->ids[i], NULL, esperar_rondas, equipo);
+		assert(error == 0);
+		(void)error;
+	}
+	return equipo;
+}
+
+void equipo_para(Equipo* equipo, int n, TareaParalela tarea, void* datos) {
+	if (equipo->hilos <= 1 || n <= 1) {
+		Reparto reparto = { tarea, datos, n, 0 };
+		trabajar(&reparto);
+		return;
+	}
+	pthread_mutex_lock(&equipo->mutex);
+	equipo->reparto = (Reparto){ tarea, datos, n, 0 };
+	equipo->trabajando = equipo->hilos - 1;
+	equipo->ronda += 1;
+	pthread_cond_broadcast(&equipo->hayRonda);
+	pthread_mutex_unlock(&equipo->mutex);
+	trabajar(&equipo->reparto);
+	pthread_mutex_lock(&equipo->mutex);
+	while (equipo->trabajando > 0)
+		pthread_cond_wait(&equipo->terminaron, &equipo->mutex);
+	pthread_mutex_unlock(&equipo->mutex);
+}
+
+void equipo_liberar(Equipo* equipo) {
+	pthread_mutex_lock(&equipo->mutex);
+	equipo->cerrar = 1;
+	pthread_cond_broadcast(&equipo->hayRonda);
+	pthread_mutex_unlock(&equipo->mutex);
+	for (int i = 0; i < equipo->hilos - 1; ++i)
+		pthread_join(equipo->ids[i], NULL);
+	pthread_mutex_destroy(&equipo->mutex);
+	pthread_cond_destroy(&equipo->hayRonda);
+	pthread_cond_destroy(&equipo->terminaron);
+	free(equipo->ids);
+	free(equipo);
+}
@@ -0,0 +1,36 @@
+#ifndef PARALELO_H
+#define PARALELO_H
+
+// Una tarea que se aplica a cada indice de un rango. Recibe los datos
+// compartidos por todas las aplicaciones y el indice a procesar.
+typedef void (*TareaParalela)(void* datos, int i);
+
+/**
+ * Aplica la tarea a cada indice en [0, n), repartiendo los indices entre
+ * 'hilos' hilos: cada hilo toma el siguiente indice sin procesar hasta que no
+ * queden mas. Vuelve cuando todos los indices fueron procesados.
+ * Con un solo hilo (o un solo indice), la tarea corre en el hilo actual.
+ */
+void paralelo_para(int hilos, int n, TareaParalela tarea, void* datos);
+
+// Un equipo de hilos que se crean una vez y se reutilizan en varios
+// 'equipo_para' seguidos, para no crear y esperar hilos en cada uno.
+typedef struct Equipo Equipo;
+
+/**
+ * Crea un equipo de 'hilos' hilos, contando al actual (que trabaja en cada
+ * 'equipo_para'). Los demas esperan hasta que haya trabajo.
+ */
+Equipo* equipo_crear(int hilos);
+
+/**
+ * Como 'paralelo_para', con los hilos del equipo.
+ */
+void equipo_para(Equipo* equipo, int n, TareaParalela tarea, void* datos);
+
+/**
+ * Termina los hilos del equipo y lo libera.
+ */
+void equipo_liberar(Equipo* equipo);
+
+#endif // PARALELO_H
@@ -0,0 +1,29 @@
+#include "reservas.h"
+
+#include <stddef.h>
+
+// Las funciones originales, que el enlazador renombra (ver reservas.h).
+void* __real_malloc(size_t tamano);
+void* __real_calloc(size_t cantidad, size_t tamano);
+void* __real_realloc(void* puntero, size_t tamano);
+
+static long long reservas;
+
+void* __wrap_malloc(size_t tamano) {
+	__atomic_add_fetch(&reservas, 1, __ATOMIC_RELAXED);
+	return __real_malloc(tamano);
+}
+
+void* __wrap_calloc(size_t cantidad, size_t tamano) {
+	__atomic_add_fetch(&reservas, 1, __ATOMIC_RELAXED);
+	return __real_calloc(cantidad, tamano);
+}
+
+void* __wrap_realloc(void* puntero, size_t tamano) {
+	__atomic_add_fetch(&reservas, 1, __ATOMIC_RELAXED);
+	return __real_realloc(puntero, tamano);
+}
+
+long long reservas_contadas(void) {
+	return __atomic_load_n(&reservas, __ATOMIC_RELAXED);
+}
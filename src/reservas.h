@@ -0,0 +1,18 @@
+#ifndef RESERVAS_H
+#define RESERVAS_H
+
+// Conteo de reservas de memoria, para los tests.
+//
+// El programa 'interprete_reservas' (ver el Makefile) se enlaza con
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc: las llamadas a esas
+// funciones desde el interprete pasan por las de reservas.c, que las cuentan.
+// Las reservas internas de la biblioteca de C (por ejemplo, los buffers de
+// stdio) no se cuentan.
+
+/**
+ * Devuelve la cantidad de llamadas a malloc, calloc y realloc hechas hasta el
+ * momento, desde todos los hilos.
+ */
+long long reservas_contadas(void);
+
+#endif // RESERVAS_H
@@ -7,22 +7,20 @@
 #include <string.h>
 
 TablaOps tabla_ops_crear() {
-	return (TablaOps){ NULL };
+	return (TablaOps){ NULL, 0 };
 }
 
 void tabla_ops_limpiar(TablaOps* tabla) {
-	EntradaTablaOps* it = tabla->entradas;
-	while (it) {
-		EntradaTablaOps* sig = it->sig;
-		free(it);
-		it = sig;
-	}
+	free(tabla->entradas);
+	tabla->entradas = NULL;
+	tabla->cantidad = 0;
 }
 
-static int existe_simbolo(TablaOps* tabla, char const* simbolo) {
-	for (EntradaTablaOps* it = tabla->entradas; it; it = it->sig)
-		if (strcmp(simbolo, it->simbolo) == 0) return 1;
-	return 0;
+EntradaTablaOps* tabla_ops_buscar(TablaOps* tabla, char const* simbolo) {
+	for (int i = 0; i < tabla->cantidad; ++i)
+		if (strcmp(simbolo, tabla->entradas[i].simbolo) == 0)
+			return &tabla->entradas[i];
+	return NULL;
 }
 
 void cargar_operador(TablaOps* tabla, char const* simbolo, int aridad, 
@@ -49,21 +47,93 @@ void cargar_operador(TablaOps* tabla, char const* simbolo, int aridad,
 		printf("En operacion \'%s\'; ", simbolo);
 		fflush(stdout); assert(0);
 	}
-	if (existe_simbolo(tabla, simbolo)) {
+	if (tabla_ops_buscar(tabla, simbolo)) {
 		printf("ERROR: la operacion \'%s\' ya esta definida.\n", simbolo);
 		fflush(stdout); assert(0);
 	}
+	if (tabla->cantidad == MAX_OPERADORES) {
+		printf("ERROR: no se pueden cargar mas de %d operaciones.\n",
+			MAX_OPERADORES);
+		fflush(stdout); assert(0);
+	}
 
-	EntradaTablaOps* nuevaEntrada = malloc(sizeof(*nuevaEntrada));
-	*nuevaEntrada = (EntradaTablaOps){
-		.sig = tabla->entradas,
+	// Las entradas se agregan de a una, por lo que crecemos de a una.
+	tabla->entradas = realloc(tabla->entradas,
+		(tabla->cantidad + 1) * sizeof(*tabla->entradas));
+	assert(tabla->entradas);
+	tabla->entradas[tabla->cantidad] = (EntradaTablaOps){
 		.eval = eval,
 		.simbolo = simbolo,
+		.id = tabla->cantidad,
 		.aridad = aridad,
 		.precedencia = precedencia,
+		.repeticion = -1,
 	};
-
-	tabla->entradas = nuevaEntrada;
+	tabla->cantidad += 1;
 
 	return;
 }
+
+void cargar_propiedades(TablaOps* tabla, char const* simbolo, int propiedades,
+	int neutro) {
+	EntradaTablaOps* entrada = tabla_ops_buscar(tabla, simbolo);
+	// Chequeamos que las propiedades sean validas.
+	if (entrada == NULL) {
+		printf("ERROR: la operacion \'%s\' no esta definida.\n", simbolo);
+		fflush(stdout); assert(0);
+	}
+	int binarias = OP_ASOCIATIVA | OP_CONMUTATIVA | OP_NEUTRO;
+	if ((entrada->aridad == 1 && (propiedades & binarias)) ||
+		(entrada->aridad == 2 && (propiedades & OP_INVOLUTIVA))) {
+		printf("ERROR: propiedades invalidas para la operacion \'%s\'.\n",
+			simbolo);
+		fflush(stdout); assert(0);
+	}
+
+	entrada->propiedades = propiedades;
+	entrada->neutro = neutro;
+}
+
+void cargar_reduccion(TablaOps* tabla, char const* simbolo,
+	FuncionReduccion reducir) {
+	EntradaTablaOps* entrada = tabla_ops_buscar(tabla, simbolo);
+	// Solo las operaciones asociativas se aplican a cadenas de operandos.
+	if (entrada == NULL || !(entrada->propiedades & OP_ASOCIATIVA)) {
+		printf("ERROR: la operacion \'%s\' no es asociativa.\n", simbolo);
+		fflush(stdout); assert(0);
+	}
+
+	entrada->reducir = reducir;
+}
+
+void cargar_repeticion(TablaOps* tabla, char const* simbolo,
+	char const* repeticion) {
+	EntradaTablaOps* entrada = tabla_ops_buscar(tabla, simbolo);
+	EntradaTablaOps* repetida = tabla_ops_buscar(tabla, repeticion);
+	// Agrupar los operandos repetidos cambia su orden, por lo que la operacion
+	// debe ser asociativa y conmutativa.
+	int propiedades = OP_ASOCIATIVA | OP_CONMUTATIVA;
+	if (entrada == NULL || (entrada->propiedades & propiedades) != propiedades) {
+		printf("ERROR: la operacion \'%s\' no es asociativa y conmutativa.\n",
+			simbolo);
+		fflush(stdout); assert(0);
+	}
+	if (repetida == NULL || repetida->aridad != 2) {
+		printf("ERROR: la operacion \'%s\' no es binaria.\n", repeticion);
+		fflush(stdout); assert(0);
+	}
+
+	entrada->repeticion = repetida->id;
+}
+
+int tabla_ops_reducir(EntradaTablaOps const* op, int const* valores, int n) {
+	if (op->reducir)
+		return op->reducir(valores, n);
+	// Los argumentos van del ultimo operando al primero.
+	int args[2] = {0, valores[0]};
+	for (int i = 1; i < n; ++i) {
+		args[0] = valores[i];
+		args[1] = op->eval(args);
+	}
+	return args[1];
+}
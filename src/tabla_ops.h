@@ -3,17 +3,37 @@
 
 #include "funcion_evaluacion.h"
 
-typedef struct EntradaTablaOps EntradaTablaOps;
-struct EntradaTablaOps {
-	EntradaTablaOps* sig;
+// Propiedades algebraicas de un operador, que permiten simplificar las
+// expresiones que lo usan. Se combinan con '|'.
+#define OP_ASOCIATIVA  1 // (a op b) op c == a op (b op c)
+#define OP_CONMUTATIVA 2 // a op b == b op a
+#define OP_NEUTRO      4 // a op neutro == a (y neutro op a == a, si conmuta)
+#define OP_INVOLUTIVA  8 // (unaria) op op a == a
+
+// Cantidad maxima de operadores: los nodos de una expresion guardan el id del
+// operador en un byte.
+#define MAX_OPERADORES 256
+
+typedef struct EntradaTablaOps {
 	FuncionEvaluacion eval;
 	char const* simbolo;
+	int id; // posicion de la entrada en la tabla.
 	int aridad;
 	int precedencia;
-};
+	int propiedades; // combinacion de OP_ASOCIATIVA, OP_CONMUTATIVA, etc.
+	int neutro;      // elemento neutro, de tener la propiedad OP_NEUTRO.
+	// aplica la operacion a un arreglo de valores de una vez (NULL si no se
+	// declaro: se aplica 'eval' de a pares).
+	FuncionReduccion reducir;
+	// id del operador que aplica la operacion repetida (ver
+	// 'cargar_repeticion'), o -1 si no se declaro.
+	int repeticion;
+} EntradaTablaOps;
 
+// Las entradas se guardan contiguas, indexadas por su id.
 typedef struct TablaOps {
 	EntradaTablaOps* entradas;
+	int cantidad;
 } TablaOps;
 
 /**
@@ -35,4 +55,42 @@ void tabla_ops_limpiar(TablaOps* tabla);
 void cargar_operador(TablaOps* tabla, char const* simbolo, int aridad, 
 	FuncionEvaluacion eval, int precedencia);
 
+/**
+ * Devuelve la entrada del operador con el simbolo dado, o NULL si no esta en
+ * la tabla.
+ */
+EntradaTablaOps* tabla_ops_buscar(TablaOps* tabla, char const* simbolo);
+
+/**
+ * Declara las propiedades algebraicas de un operador ya cargado (ver
+ * OP_ASOCIATIVA, etc.). 'neutro' solo se usa si se incluye OP_NEUTRO.
+ * Las propiedades deben valer para la aritmetica de 'int' con desborde, ya que
+ * se usan para reescribir las expresiones antes de evaluarlas.
+ */
+void cargar_propiedades(TablaOps* tabla, char const* simbolo, int propiedades,
+	int neutro);
+
+/**
+ * Declara una funcion que aplica un operador asociativo ya cargado a un arreglo
+ * de valores, con el mismo resultado que aplicarlo de a pares (por ejemplo,
+ * usando instrucciones vectoriales). Se usa con las cadenas del operador.
+ */
+void cargar_reduccion(TablaOps* tabla, char const* simbolo,
+	FuncionReduccion reducir);
+
+/**
+ * Declara que aplicar un operador asociativo y conmutativo ya cargado a k
+ * copias de un mismo operando equivale a aplicar el operador 'repeticion' (ya
+ * cargado y binario) al operando y a k: por ejemplo, 'x + x + x' es 'x * 3'.
+ * Se usa para evaluar una sola vez los alias repetidos de una cadena.
+ */
+void cargar_repeticion(TablaOps* tabla, char const* simbolo,
+	char const* repeticion);
+
+/**
+ * Aplica el operador asociativo a los 'n' valores del arreglo (n >= 1), de
+ * izquierda a derecha: con su funcion de reduccion, si la tiene.
+ */
+int tabla_ops_reducir(EntradaTablaOps const* op, int const* valores, int n);
+
 #endif // TABLA_OPS_H